@@ -0,0 +1,142 @@
+#! bin/bash
+# Verifica che le esecuzioni a piu' passi diano la stessa rete di un'esecuzione normale:
+# checkpoint interrotto e ripreso, stato con genomi aggiunti, cache delle coppie, shard statici e dinamici.
+# Usa i primi genomi del file di input, le reti vengono confrontate ordinate.
+
+inFile="../../files/mycoplasma.faa"
+k=5
+threads=2
+genomes=6
+workDir="runs_tmp"
+main="../../main"
+
+function usage() {
+    echo "Usage: $0 [-i input_file] [-k kmer_size] [-t threads] [-g genomes] [-w work_dir]"
+    echo "Options:"
+    echo "  -i: Input file path (../../files/mycoplasma.faa default)"
+    echo "  -k: Size of kmers (5 default)"
+    echo "  -t: Number of threads (2 default)"
+    echo "  -g: Number of genomes taken from the input file, at least 4 (6 default)"
+    echo "  -w: Directory of the temporary files, deleted at the end (runs_tmp default)"
+    echo "  ?: Display this help message"
+}
+
+while getopts ":i:k:t:g:w:" opt; do
+    case ${opt} in
+        i )
+            inFile=$OPTARG
+            ;;
+        k )
+            k=$OPTARG
+            ;;
+        t )
+            threads=$OPTARG
+            ;;
+        g )
+            genomes=$OPTARG
+            ;;
+        w )
+            workDir=$OPTARG
+            ;;
+        \? )
+            echo "Invalid option: $OPTARG" 1>&2
+            usage
+            exit 1
+            ;;
+        : )
+            echo "Invalid option: $OPTARG requires an argument" 1>&2
+            usage
+            exit 1
+            ;;
+    esac
+done
+
+if [ ! -x "$main" ]; then
+    echo "Missing $main, run compile.sh first"
+    exit 1
+fi
+
+if [ "$genomes" -lt 4 ]; then
+    echo "At least 4 genomes are needed"
+    usage
+    exit 1
+fi
+
+rm -rf "$workDir"
+mkdir -p "$workDir" || exit 1
+
+# primi genomi dell'input (due righe per gene) e sottoinsieme senza gli ultimi due
+function takeGenomes() {
+    awk -v n=$1 'NR % 2 == 1 { if($1 != last) { ++count; last = $1 } } count <= n' "$inFile" > "$2"
+}
+takeGenomes $genomes "$workDir/all.faa"
+takeGenomes $((genomes - 2)) "$workDir/part.faa"
+
+failed=0
+
+function run() {
+    local name=$1
+    shift
+    "$main" -k $k -t $threads "$@" > "$workDir/$name.log" 2>&1
+}
+
+function check() {
+    local name=$1
+    shift
+    if cmp -s <(sort "$workDir/plain.net") <(sort "$@"); then
+        echo "-> $name: same network"
+    else
+        echo "-> $name: different network"
+        failed=1
+    fi
+}
+
+run plain -i "$workDir/all.faa" -o "$workDir/plain" || { echo "Plain run failed"; exit 1; }
+
+# checkpoint dopo ogni coppia, interrotto appena ne contiene una e ripreso
+# (main lanciato direttamente: il segnale deve arrivare al processo, non a una subshell)
+"$main" -k $k -t $threads -i "$workDir/all.faa" -o "$workDir/checkpoint" --checkpoint 0 > "$workDir/checkpoint.log" 2>&1 &
+pid=$!
+while kill -0 $pid 2> /dev/null && ! grep -q "^pair" "$workDir/checkpoint.net.ckpt" 2> /dev/null; do
+    sleep 0.01
+done
+kill -9 $pid 2> /dev/null
+wait $pid 2> /dev/null
+run resume -i "$workDir/all.faa" -o "$workDir/checkpoint" --resume
+check "checkpoint kill/resume" "$workDir/checkpoint.net"
+
+# stato dei primi genomi, poi gli ultimi due aggiunti
+run state -i "$workDir/part.faa" -o "$workDir/part" --state "$workDir/part.state"
+run add -i "$workDir/all.faa" -o "$workDir/add" --add "$workDir/part.state"
+check "--add $((genomes - 2)) -> $genomes" "$workDir/add.net"
+
+# cache riempita dai primi genomi, letta dal secondo calcolo in modalita' -m
+run cacheFill -i "$workDir/part.faa" -o "$workDir/cacheFill" --pair-cache "$workDir/pairs"
+run cacheHit -i "$workDir/all.faa" -o "$workDir/cacheHit" --pair-cache "$workDir/pairs" -m
+if ! grep -q "pair cache" "$workDir/cacheHit.log"; then
+    echo "-> pair cache: no hits"
+    failed=1
+fi
+check "pair cache" "$workDir/cacheHit.net"
+
+# shard statici 0/2 e 1/2, uniti
+run shard0 -i "$workDir/all.faa" -o "$workDir/shard0" --shard 0/2
+run shard1 -i "$workDir/all.faa" -o "$workDir/shard1" --shard 1/2
+run staticMerge -i "$workDir/all.faa" -o "$workDir/staticMerge" --merge "$workDir/shard0.net" --merge "$workDir/shard1.net"
+# l'unione contiene le righe degli shard e quelle dei genomi con se stessi
+check "static shards" "$workDir/staticMerge.net"
+
+# due processi contemporanei che si dividono i lotti, uniti
+mkdir -p "$workDir/locks"
+run dynamic0 -i "$workDir/all.faa" -o "$workDir/dynamic0" --shard-dir "$workDir/locks" &
+pid=$!
+run dynamic1 -i "$workDir/all.faa" -o "$workDir/dynamic1" --shard-dir "$workDir/locks"
+wait $pid
+run dynamicMerge -i "$workDir/all.faa" -o "$workDir/dynamicMerge" --merge "$workDir/dynamic0.net" --merge "$workDir/dynamic1.net"
+check "dynamic shards" "$workDir/dynamicMerge.net"
+
+if [ $failed -ne 0 ]; then
+    echo "Logs and networks kept in $workDir"
+    exit 1
+fi
+rm -rf "$workDir"
@@ -0,0 +1,71 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "../../lib/ScoresContainer.hh"
+#include "../../utils/StopWatch.hh"
+
+
+// Confronta i layout di ScoresContainer su una coppia grande:
+// scrittura per righe (come calculateRow), a tile (come calculateTile) e scansione per colonne (come checkForBBH).
+// g++ -std=c++11 -O2 benchmark.cc -o benchmark && ./benchmark [righe] [colonne]
+
+using namespace score;
+
+struct Layout {
+    const char* name;
+    std::size_t blockSide;
+    bool transposed;
+};
+
+int main(int argc, char* argv[]) {
+    std::size_t rows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 6000;
+    std::size_t cols = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 6000;
+
+    const Layout layouts[] = {
+        {"row-major", 1, false},
+        {"blocked 32", 32, false},
+        {"blocked 32 transposed", 32, true},
+        {"blocked 64 transposed", 64, true}
+    };
+
+    std::cout << "rows: " << rows << ", cols: " << cols << "\n";
+    for (const Layout& layout : layouts) {
+        stopwatch::StopWatch sw;
+        ScoresContainer scores(rows, cols, layout.blockSide, layout.transposed);
+
+        sw.start();
+        for (std::size_t row = 0; row < rows; ++row)
+            for (std::size_t col = 0; col < cols; ++col)
+                scores.setScoreAt(row, col, static_cast<double>((row * 31 + col * 17) % 1000) / 1000);
+        unsigned int writeTime = sw.stop('m');
+
+        // scrittura a tile, come calculateTile
+        const std::size_t tile = 128;
+        sw.start();
+        for (std::size_t rowFirst = 0; rowFirst < rows; rowFirst += tile)
+            for (std::size_t colFirst = 0; colFirst < cols; colFirst += tile)
+                for (std::size_t row = rowFirst; row < rows && row < rowFirst + tile; ++row)
+                    for (std::size_t col = colFirst; col < cols && col < colFirst + tile; ++col)
+                        scores.setScoreAt(row, col, static_cast<double>((row * 31 + col * 17) % 1000) / 1000);
+        unsigned int tileTime = sw.stop('m');
+
+        // il massimo di ogni colonna, come la ricerca delle righe migliori
+        double sink = 0;
+        sw.start();
+        for (std::size_t col = 0; col < cols; ++col) {
+            double best = -1;
+            for (std::size_t row = 0; row < rows; ++row) {
+                double current = scores.getScoreAt(row, col);
+                best = current > best ? current : best;
+            }
+            sink += best;
+        }
+        unsigned int readTime = sw.stop('m');
+
+        std::cout << layout.name << ": row writes " << writeTime << " ms, tile writes " << tileTime << " ms, column scans " << readTime << " ms"
+            << " (" << sink << ")\n";
+    }
+
+    return 0;
+}
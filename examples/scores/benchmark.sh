@@ -0,0 +1,9 @@
+#! bin/bash
+# Compila ed esegue il confronto dei layout di ScoresContainer (scrittura per righe, lettura per colonne).
+
+rows=${1:-6000}
+cols=${2:-6000}
+
+g++ -std=c++11 -O2 benchmark.cc -o benchmark || exit 1
+./benchmark $rows $cols
+rm -f benchmark
@@ -0,0 +1,88 @@
+#! bin/bash
+# Confronta i cache miss della visita a tile (-T automatico) con quella a un task per riga (-T 0).
+# Richiede perf (linux-tools).
+calculate_k_path="./../../scripts/calculate_k.py"
+
+
+inFile=""
+outFile=""
+tileSizes="0 auto"
+events="cache-references,cache-misses,L1-dcache-loads,L1-dcache-load-misses,LLC-loads,LLC-load-misses"
+
+function usage() {
+    echo "Usage: $0 [-i input_file] [-o output_file] [-s tile_sizes]"
+    echo "Options:"
+    echo "  -i: Input file path"
+    echo "  -o: Output file path prefix"
+    echo "  -s: Space separated tile sizes to compare (\"0 auto\" default, 0 is one task per row)"
+    echo "  ?: Display this help message"
+}
+
+while getopts ":i:o:s:" opt; do
+    case ${opt} in
+        i )
+            inFile=$OPTARG
+            ;;
+        o )
+            outFile=$OPTARG
+            ;;
+        s )
+            tileSizes=$OPTARG
+            ;;
+        \? )
+            echo "Invalid option: $OPTARG" 1>&2
+            usage
+            exit 1
+            ;;
+        : )
+            echo "Invalid option: $OPTARG requires an argument" 1>&2
+            usage
+            exit 1
+            ;;
+    esac
+done
+
+if [ -z "$inFile" ]; then
+    echo "Missing input file"
+    usage
+    exit 1
+fi
+
+if [ -z "$outFile" ]; then
+    echo "Missing output file"
+    usage
+    exit 1
+fi
+
+if ! command -v perf > /dev/null; then
+    echo "perf not found"
+    exit 1
+fi
+
+
+k=$(python3 $calculate_k_path $inFile)
+proc=$(nproc)
+
+for tileSize in $tileSizes; do
+    tileOption="-T $tileSize"
+    if [ "$tileSize" == "auto" ]; then
+        tileOption=""
+    fi
+
+    mainCommand="../../main -i $inFile -k $k -o ${outFile}_${tileSize} -t $proc $tileOption"
+    echo "-> tile size $tileSize: $mainCommand"
+    perf stat -e $events -x , -o "${outFile}_${tileSize}.perf" $mainCommand > /dev/null 2>&1
+    # evento, valore
+    awk -F , '!/^#/ && NF > 2 {print "   " $3 ": " $1}' "${outFile}_${tileSize}.perf"
+done
+
+# le reti devono essere identiche
+first=""
+for tileSize in $tileSizes; do
+    if [ -z "$first" ]; then
+        first=$tileSize
+    elif ! cmp -s <(sort "${outFile}_${first}.net") <(sort "${outFile}_${tileSize}.net"); then
+        echo "Different networks for tile sizes $first and $tileSize"
+        exit 1
+    fi
+done
@@ -0,0 +1,71 @@
+#ifndef BBH_ENGINE_INCLUDE_GUARD
+#define BBH_ENGINE_INCLUDE_GUARD 1
+
+#include <string>
+
+
+/**
+ * @file BBHEngine.hh
+ * @brief Definitions of the engines that extract the Bidirectional Best Hits of a genome pair.
+ */
+
+/**
+ * @namespace homology
+ * @brief Namespace containing definitions for homology computation related classes.
+ */
+
+namespace homology {
+
+    /**
+     * @brief The strategies used by Homology to extract the Bidirectional Best Hits (BBH).
+     *
+     * - streaming: the best score and the tied genes of every row and of every column are kept
+     *   while the scores are computed, the BBH are read from these summaries (memory linear in the genes)
+     * - sparse: only the nonzero scores are stored, compressed by column in a SparseScoresContainer,
+     *   the compressed columns are scanned in a second pass (memory linear in the nonzero scores)
+     * - matrix: every score is stored in a ScoresContainer, the columns are scanned in a second pass
+     */
+    enum class BBHEngine {
+        streaming,
+        sparse,
+        matrix
+    };
+
+    /**
+     * @brief Converts an engine name given on the command line.
+     * @param name "streaming", "sparse" or "matrix".
+     * @param engine Set to the engine with that name.
+     * @return False if the name is unknown, in this case engine is unchanged.
+     */
+    inline bool parseBBHEngine(const std::string& name, BBHEngine& engine) {
+        if(name == "streaming")
+            engine = BBHEngine::streaming;
+        else if(name == "sparse")
+            engine = BBHEngine::sparse;
+        else if(name == "matrix")
+            engine = BBHEngine::matrix;
+        else
+            return false;
+        return true;
+    }
+
+    /**
+     * @brief Retrieves the name of an engine, the same accepted by parseBBHEngine.
+     * @param engine The engine.
+     * @return The name of the engine.
+     */
+    inline std::string getBBHEngineName(const BBHEngine engine) {
+        switch(engine) {
+            case BBHEngine::sparse:
+                return "sparse";
+            case BBHEngine::matrix:
+                return "matrix";
+            case BBHEngine::streaming:
+            default:
+                return "streaming";
+        }
+    }
+
+}
+
+#endif
@@ -0,0 +1,324 @@
+#ifndef CHECKPOINT_INCLUDE_GUARD
+#define CHECKPOINT_INCLUDE_GUARD 1
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <map>
+#include <utility>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "VariablesTypes.hh"
+
+
+/**
+ * @file Checkpoint.hh
+ * @brief Definitions for the Checkpoint class.
+ */
+
+/**
+ * @namespace homology
+ * @brief Namespace containing definitions for homology computation related classes.
+ */
+
+namespace homology {
+
+    /**
+     * @class Checkpoint
+     * @brief Records the completed genome pairs of a run, so that an interrupted run can be resumed.
+     *
+     * The lines of a pair are written to the output as a single block when the pair is complete,
+     * together with its minimum BBH score: the output is always a sequence of whole pairs. The
+     * checkpoint is a log next to the output: every interval the output is synced to disk, then a
+     * record is appended for each pair completed since the previous save, with its minimum and the
+     * size of the output up to its block, and the log is synced too. A recorded size is therefore
+     * always on disk, and a save costs only the pairs completed since the previous one. A resumed run
+     * truncates the output to the size of the last whole record, dropping the pairs completed after
+     * it, and skips the recorded pairs.
+     */
+    class Checkpoint {
+        private:
+            using index_t = shared::indexType;
+            using score_t = shared::scoreType;
+            using pair_t = std::pair<index_t, index_t>;
+            // coppie completate e loro minimo, (g, g) per il confronto di un genoma con se stesso
+            using completed_t = std::map<pair_t, score_t>;
+            using clock_t = std::chrono::steady_clock;
+
+            std::string path_;
+            std::string outputPath_;
+            std::string signature_;
+            std::chrono::seconds interval_;
+            completed_t completed_;
+            // byte dell'output che contengono le coppie completate
+            std::size_t written_;
+            // record delle coppie completate dopo l'ultimo salvataggio
+            std::string pending_;
+            clock_t::time_point lastSave_;
+            // log aperto in append e descrittore dell'output per fsync
+            std::FILE* file_;
+            int outputFd_;
+            std::mutex mutex_;
+
+            /**
+             * @brief Syncs the output and appends the pending records to the log, with mutex_ held.
+             * @param output The output stream.
+             */
+            inline void save(std::fstream& output, const std::unique_lock<std::mutex>& lock);
+
+            /**
+             * @brief Writes the header and the records of the log to a temporary file, synced and renamed
+             *        over the log, then opens the log to append.
+             * @param records The records.
+             */
+            inline void create(const std::string& records);
+
+            /**
+             * @brief Syncs a file descriptor to disk.
+             */
+            inline void sync(const int fd, const std::string& what) const;
+
+            /**
+             * @brief Gets the size of a file.
+             * @param path The file.
+             * @return The size in bytes, 0 if the file does not exist.
+             */
+            inline static std::size_t getFileSize(const std::string& path);
+
+        public:
+            /**
+             * @brief Constructs the checkpoint of a run without completed pairs.
+             * @param outputPath The output file, the checkpoint is outputPath + ".ckpt".
+             * @param signature Describes the run (input, k, discard...): a checkpoint can be resumed only by a run with the same signature.
+             * @param interval Seconds between two checkpoints (0 after every pair).
+             */
+            inline explicit Checkpoint(const std::string& outputPath, const std::string& signature, const std::size_t interval);
+
+            Checkpoint(const Checkpoint&) = delete;
+            Checkpoint& operator=(const Checkpoint&) = delete;
+            Checkpoint(Checkpoint&&) = delete;
+            Checkpoint& operator=(Checkpoint&&) = delete;
+
+            /**
+             * @brief Closes the log and the output descriptor.
+             */
+            inline ~Checkpoint();
+
+            /**
+             * @brief Loads the saved checkpoint and truncates the output to the pairs it contains, a partial
+             *        last record is dropped. Nothing must have been written to the output yet. A missing
+             *        checkpoint is not an error.
+             * @return The number of completed pairs loaded.
+             */
+            inline index_t resume();
+
+            /**
+             * @brief Starts recording the pairs after the current end of the output, creating the log if not resumed.
+             *        Called once, after resume if any.
+             */
+            inline void start();
+
+            /**
+             * @brief Checks if a pair is completed, thread safe.
+             * @param row The id of the row genome.
+             * @param col The id of the column genome (row for a genome with itself).
+             * @return True if the pair is completed.
+             */
+            inline bool isCompleted(const index_t row, const index_t col);
+
+            /**
+             * @brief Writes the lines of a completed pair to the output and records the pair, thread safe.
+             *        Saves the checkpoint if the interval has passed since the last save.
+             * @param row The id of the row genome.
+             * @param col The id of the column genome (row for a genome with itself).
+             * @param min The minimum BBH score of the pair.
+             * @param lines The lines of the pair, each one ending with a newline.
+             * @param output The output stream.
+             */
+            inline void complete(const index_t row, const index_t col, const score_t min, const std::string& lines, std::fstream& output);
+
+            /**
+             * @brief Saves the checkpoint now, thread safe.
+             * @param output The output stream, flushed before saving.
+             */
+            inline void save(std::fstream& output);
+
+            /**
+             * @brief Iterates the completed pairs: f(row, col, min).
+             * @param f The function called for each pair.
+             */
+            template<typename F>
+            inline void forEachCompleted(F f) const;
+    };
+
+    inline
+    Checkpoint::Checkpoint(const std::string& outputPath, const std::string& signature, const std::size_t interval)
+    : path_(outputPath + ".ckpt"), outputPath_(outputPath), signature_(signature), interval_(interval), written_(0),
+    lastSave_(clock_t::now()), file_(nullptr), outputFd_(-1) {}
+
+    inline
+    Checkpoint::~Checkpoint() {
+        if(file_ != nullptr)
+            std::fclose(file_);
+        if(outputFd_ >= 0)
+            close(outputFd_);
+    }
+
+    inline std::size_t
+    Checkpoint::getFileSize(const std::string& path) {
+        struct stat info;
+        if(stat(path.c_str(), &info) != 0)
+            return 0;
+        return static_cast<std::size_t>(info.st_size);
+    }
+
+    inline void
+    Checkpoint::sync(const int fd, const std::string& what) const {
+        if(fsync(fd) != 0)
+            throw std::runtime_error("syncing " + what + ": " + std::strerror(errno));
+    }
+
+    inline void
+    Checkpoint::create(const std::string& records) {
+        std::string tmpPath = path_ + ".tmp";
+        std::FILE* file = std::fopen(tmpPath.c_str(), "w");
+        if(file == nullptr)
+            throw std::runtime_error("checkpoint " + tmpPath + ": " + std::strerror(errno));
+        std::string header = "pandelos-checkpoint 2\n" + signature_ + "\n";
+        bool failed =
+            std::fputs(header.c_str(), file) < 0 || std::fputs(records.c_str(), file) < 0 ||
+            std::fflush(file) != 0 || fsync(fileno(file)) != 0;
+        failed = std::fclose(file) != 0 || failed;
+        // rename sostituisce il log precedente in modo atomico
+        if(failed || std::rename(tmpPath.c_str(), path_.c_str()) != 0)
+            throw std::runtime_error("writing checkpoint " + tmpPath);
+
+        file_ = std::fopen(path_.c_str(), "a");
+        if(file_ == nullptr)
+            throw std::runtime_error("checkpoint " + path_ + ": " + std::strerror(errno));
+    }
+
+    inline Checkpoint::index_t
+    Checkpoint::resume() {
+        std::ifstream file(path_);
+        if(!file.is_open())
+            return 0;
+
+        std::string line;
+        if(!std::getline(file, line) || line != "pandelos-checkpoint 2")
+            throw std::runtime_error("invalid checkpoint " + path_);
+        if(!std::getline(file, line) || line != signature_)
+            throw std::runtime_error("checkpoint " + path_ + " of a different run (" + line + ")");
+
+        // i minimi sono in esadecimale: riletti identici
+        completed_t completed;
+        std::string records;
+        std::size_t offset = 0;
+        while(std::getline(file, line)) {
+            // un record senza a capo e' stato interrotto durante la scrittura
+            if(file.eof())
+                break;
+            std::istringstream record(line);
+            std::string key, min;
+            index_t row, col;
+            std::size_t size;
+            if(!(record >> key >> row >> col >> min >> size) || key != "pair" || size < offset)
+                throw std::runtime_error("invalid checkpoint " + path_);
+            completed[pair_t(row, col)] = std::strtod(min.c_str(), nullptr);
+            offset = size;
+            records += line + "\n";
+        }
+
+        // le righe scritte dopo l'ultimo record appartengono a coppie che verranno ricalcolate
+        std::size_t size = getFileSize(outputPath_);
+        if(size < offset)
+            throw std::runtime_error("output " + outputPath_ + " shorter than its checkpoint");
+        if(truncate(outputPath_.c_str(), static_cast<off_t>(offset)) != 0)
+            throw std::runtime_error("truncating " + outputPath_ + ": " + std::strerror(errno));
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        // il log riscritto senza l'eventuale record parziale, i nuovi record seguono
+        create(records);
+        completed_.swap(completed);
+        return completed_.size();
+    }
+
+    inline void
+    Checkpoint::start() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if(file_ == nullptr)
+            create("");
+        outputFd_ = open(outputPath_.c_str(), O_WRONLY);
+        if(outputFd_ < 0)
+            throw std::runtime_error("output " + outputPath_ + ": " + std::strerror(errno));
+        written_ = getFileSize(outputPath_);
+        lastSave_ = clock_t::now();
+    }
+
+    inline bool
+    Checkpoint::isCompleted(const index_t row, const index_t col) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return completed_.find(pair_t(row, col)) != completed_.end();
+    }
+
+    inline void
+    Checkpoint::complete(const index_t row, const index_t col, const score_t min, const std::string& lines, std::fstream& output) {
+        // blocco e record insieme: i record seguono l'ordine dei blocchi nell'output
+        std::unique_lock<std::mutex> lock(mutex_);
+        output<<lines;
+        written_ += lines.size();
+        completed_[pair_t(row, col)] = min;
+
+        char record[128];
+        std::snprintf(record, sizeof(record), "pair %zu %zu %a %zu\n", static_cast<std::size_t>(row), static_cast<std::size_t>(col), min, written_);
+        pending_ += record;
+
+        if(clock_t::now() - lastSave_ >= interval_)
+            save(output, lock);
+    }
+
+    inline void
+    Checkpoint::save(std::fstream& output) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        save(output, lock);
+    }
+
+    inline void
+    Checkpoint::save(std::fstream& output, const std::unique_lock<std::mutex>&) {
+        // prima l'output su disco, poi i record che lo descrivono
+        output.flush();
+        if(!output.good())
+            throw std::runtime_error("writing " + outputPath_);
+        sync(outputFd_, outputPath_);
+
+        if(!pending_.empty()) {
+            if(std::fputs(pending_.c_str(), file_) < 0 || std::fflush(file_) != 0)
+                throw std::runtime_error("writing checkpoint " + path_);
+            sync(fileno(file_), path_);
+            pending_.clear();
+        }
+        lastSave_ = clock_t::now();
+    }
+
+    template<typename F>
+    inline void
+    Checkpoint::forEachCompleted(F f) const {
+        for(auto pair = completed_.begin(); pair != completed_.end(); ++pair)
+            f(pair->first.first, pair->first.second, pair->second);
+    }
+
+}
+
+
+#endif
@@ -15,7 +15,6 @@
 #include "bbh/BBHCandidatesContainer.hh"
 #include "bbh/MinBBHContainer.hh"
 #include <cmath>
-#include <unordered_set>
 #include <iomanip>
 
 #include "kmers/KmerMapper.hh"
@@ -49,6 +48,7 @@ namespace homology {
             using k_t = shared::kType;
             using index_t = shared::indexType;
             using score_t = shared::scoreType;
+            using stored_t = shared::storedScoreType;
             using multiplicity_t = shared::multiplicityType;
             using minBBH_t = bbh::MinBBHContainer;
 
@@ -66,9 +66,6 @@ namespace homology {
             using gene_tp = gene_t*;
 
             
-            using BBHCandidate_t = bbh::BBHCandidate;
-            using BBHCandidate_tp = BBHCandidate_t*;
-            using BBHCandidate_tr = BBHCandidate_t&;
 
             using BBHcandidatesContainer_t = bbh::BBHCandidatesContainer;
             using BBHcandidatesContainer_tp = BBHcandidatesContainer_t*;
@@ -163,6 +160,17 @@ namespace homology {
             inline score_t
             calculateSimilarity(kmersContainer_tr gene1Container, kmersContainer_tr gene2Container) const;
 
+            /**
+             * @brief Keeps the rows whose exact score with a column is the best of the column. The fragment
+             *        factor scales the scores, so equal codes (see ScoreCodec) may belong to different scores.
+             * @param rowGenes The genes in the row.
+             * @param colGene The gene of the column.
+             * @param rows The rows with the best code of the column, reduced to those with the best score.
+             * @return The best score of the column.
+             */
+            inline score_t
+            resolveTies(const genome_t::gene_ctr rowGenes, gene_tr colGene, std::vector<index_t>& rows) const;
+
             /**
              * @brief Calculates Bidirectional Best Hits (BBH) between genes of different genomes.
              * @param genome1 The first genome.
@@ -324,6 +332,28 @@ namespace homology {
 
 
     
+    inline FragHomology::score_t
+    FragHomology::resolveTies(const genome_t::gene_ctr rowGenes, gene_tr colGene, std::vector<index_t>& rows) const {
+        // stesso ordine dei geni di calculateRow: il punteggio ricalcolato e' quello codificato
+        score_t best = 0;
+        // le righe tenute sono compattate all'inizio del vettore, senza allocare
+        index_t kept = 0;
+        for(index_t i = 0; i < rows.size(); ++i) {
+            score_t score = calculateSimilarity(rowGenes[rows[i]], colGene);
+            if(score > best) {
+                best = score;
+                kept = 0;
+                rows[kept++] = rows[i];
+            } else if(score == best) {
+                rows[kept++] = rows[i];
+            }
+        }
+        rows.resize(kept);
+        return best;
+    }
+
+
+    
     void FragHomology::calculateBidirectionalBestHit(genome::FragGenomesContainer& gc, bool mode) {
         mins_.resize(gc.size());
         mins_.print();
@@ -414,7 +444,7 @@ namespace homology {
         genome_t::gene_ctr rowGenes = rowGenome.getGenes();
 
 
-        BBHcandidatesContainer_t bestRows(rowGenes.size(), colGenes.size());
+        BBHcandidatesContainer_t bestRows(rowGenes.size());
 
         ScoresContainer scores(rowGenes.size(), colGenes.size());
 
@@ -445,7 +475,7 @@ namespace homology {
         genome_t::gene_ctr genes = genome.getGenes();
         // genome_t::gene_ctr rowGenes = genome.getGenes();
 
-        BBHcandidatesContainer_t bestRows(genome.size(), genome.size());
+        BBHcandidatesContainer_t bestRows(genome.size());
         ScoresContainer scores(genome.size(), genome.size());
 
         calculateRowSame(
@@ -534,59 +564,58 @@ namespace homology {
 
         auto& poolRef = *pool_;
 
-        // auto matchp = candidates.getPossibleMatch(rowGenes.size());
-        auto matchp = candidates.getPossibleMatch(colGenes.size(), poolRef);
+        const auto match = candidates.getPossibleMatch(colGenes.size(), poolRef);
 
-        auto& match = *matchp; 
         
-        // BBHcandidatesContainer_t::set_tr matchRef = *match;
-        // bbh::BidirectionalBestHitContainer& bbhContainerRef = *bbh;
         // passo per tutte le colonne "candidate"
 
-        for(auto col = match.begin(); col != match.end(); ++col) {
-            const auto& currentColRef = *col;
-            
-            
-                poolRef.execute(
-                    [&currentColRef, &colGenes, &rowGenes, &scores, &candidates, this, &sharedMin, &minMutex] {
-                        
+        // colonne candidate ordinate, divise in intervalli di costo simile
+        auto ranges = BBHcandidatesContainer_t::getBalancedRanges(match, 4 * poolRef.getTotalThread(), false);
+        for(auto range = ranges.begin(); range != ranges.end(); ++range) {
+            const BBHcandidatesContainer_t::range_t currentRange = *range;
+            poolRef.execute(
+                [currentRange, &match, &colGenes, &rowGenes, &scores, &candidates, this, &sharedMin, &minMutex] {
+                    // righe con il punteggio migliore della colonna, in ordine: riusate da ogni colonna del task
+                    std::vector<index_t> currentBestIndexs;
+                    for(index_t position = currentRange.first; position < currentRange.second; ++position) {
+                        const index_t currentColRef = match[position];
                         auto& fwRef = *fw;
-                        score_t bestScore = -1;
-                        
+                        stored_t bestScore = 0;
+                        currentBestIndexs.clear();
 
-                        std::unordered_set<index_t> currentBestIndexs;
-
-                        // index_t colGeneId = currentColRef.first;
-                        index_t colGeneId = currentColRef;;
+                        index_t colGeneId = currentColRef;
                         gene_tr currentColGene = colGenes[colGeneId];
                         // estrae le migliori righe per la colonna corrente
                         // e li memorizza in current best indexs
 
                         for(index_t row = 0; row < rowGenes.size(); ++row) {
-                            score_t currentScore = scores.getScoreAt(row, colGeneId);
+                            stored_t currentScore = scores.getScoreAt(row, colGeneId);
 
-                            if(currentScore > bestScore && currentScore > 0.0) {
+                            if(currentScore > bestScore) {
                                 bestScore = currentScore;
                                 currentBestIndexs.clear();
-                                currentBestIndexs.emplace(row);
-                            } else if(currentScore == bestScore && currentScore > 0.0) {
-                                currentBestIndexs.emplace(row);
+                                currentBestIndexs.push_back(row);
+                            } else if(currentScore == bestScore && currentScore > 0) {
+                                currentBestIndexs.push_back(row);
                             }
                         }
 
                         // passa per tutte le righe con il punteggio migliore
                         // e se quel punteggio è il migliore anche per la riga
                         // crea il bbh
-                        if(bestScore > 0.0) {
+                        if(bestScore > 0) {
 
                             score_t minBBH = 2;
-                    
+
                             index_t currentColGeneFileLine = currentColGene.getGeneFilePosition();
-                    
+                            score_t exactBestScore = resolveTies(rowGenes, currentColGene, currentBestIndexs);
+
                             for(auto index = currentBestIndexs.begin(); index != currentBestIndexs.end(); ++index) {
                                 index_t currentIndex = *index;
-                                
-                                if(bestScore == candidates.getBestScoreForCandidate(currentIndex)) {
+
+                                // il migliore della colonna confrontato con quello esatto della riga
+                                score_t rowBestScore = candidates.getBestScoreForCandidate(currentIndex);
+                                if(exactBestScore == rowBestScore) {
                                     fwRef.write(
                                         std::to_string(
                                             rowGenes[currentIndex].getGeneFilePosition()
@@ -594,9 +623,9 @@ namespace homology {
                                         std::to_string(
                                             currentColGeneFileLine
                                         ) + "," +
-                                        std::to_string(bestScore)
+                                        std::to_string(rowBestScore)
                                         , outStream_);
-                                    minBBH = bestScore < minBBH ? bestScore : minBBH;
+                                    minBBH = rowBestScore < minBBH ? rowBestScore : minBBH;
                                 }
                             }
                             if(minBBH < sharedMin) {
@@ -604,10 +633,9 @@ namespace homology {
                                 sharedMin = minBBH < sharedMin ? minBBH : sharedMin;
                             }
                         }
-
-                        
                     }
-                );
+                }
+            );
         }
         // poolRef.waitTasks();
 
@@ -617,7 +645,6 @@ namespace homology {
         
         // poolRef.waitTasks();
 
-        delete matchp;
         return sharedMin;
     }
 
@@ -629,61 +656,65 @@ namespace homology {
     ) {
         auto& poolRef = *pool_;
 
-        auto matchp = candidates.getPossibleMatch(genes.size(), poolRef);
-        // auto matchp = candidates.getPossibleMatch(genes.size());
-        auto& match = *matchp; 
-        // BBHcandidatesContainer_t::set_tr matchRef = *match;
+        const auto match = candidates.getPossibleMatch(genes.size(), poolRef);
         
-        // bbh::BidirectionalBestHitContainer& bbhContainerRef = *bbh;
         
         // passo per tutte le colonne "candidate"
-        for(auto col = match.begin(); col != match.end(); ++col) {
-            const auto& currentColRef = *col;
+        // colonne candidate ordinate, divise in intervalli di costo simile
+        auto ranges = BBHcandidatesContainer_t::getBalancedRanges(match, 4 * poolRef.getTotalThread(), true);
+        for(auto range = ranges.begin(); range != ranges.end(); ++range) {
+            const BBHcandidatesContainer_t::range_t currentRange = *range;
             poolRef.execute(
-                [&currentColRef, &genes, &scores, &candidates, this] {
-                    auto& fwRef = *fw;
-                    score_t bestScore = -1;
-
-                    std::unordered_set<index_t> currentBestIndexs;
-                    // index_t colGeneId = currentColRef.first;
-                    index_t colGeneId = currentColRef;
-                    gene_tr currentColGene = genes[colGeneId];
-                    // estrae le migliori righe per la colonna corrente
-                    // e li memorizza in current best indexs
-
-                    // le prime righe fino alla diagonale
-                    for(index_t row = 0; row < colGeneId; ++row) {
-                        score_t currentScore = scores.getScoreAt(row, colGeneId);
-
-                        if(currentScore > bestScore && currentScore > 0.0) {
-                            bestScore = currentScore;
-                            currentBestIndexs.clear();
-                            currentBestIndexs.insert(row);
-                        } else if(currentScore == bestScore && currentScore > 0.0) {
-                            currentBestIndexs.insert(row);
+                [currentRange, &match, &genes, &scores, &candidates, this] {
+                    // righe con il punteggio migliore della colonna, in ordine: riusate da ogni colonna del task
+                    std::vector<index_t> currentBestIndexs;
+                    for(index_t position = currentRange.first; position < currentRange.second; ++position) {
+                        const index_t currentColRef = match[position];
+                        auto& fwRef = *fw;
+                        stored_t bestScore = 0;
+                        currentBestIndexs.clear();
+                        index_t colGeneId = currentColRef;
+                        gene_tr currentColGene = genes[colGeneId];
+                        // estrae le migliori righe per la colonna corrente
+                        // e li memorizza in current best indexs
+
+                        // le prime righe fino alla diagonale
+                        for(index_t row = 0; row < colGeneId; ++row) {
+                            stored_t currentScore = scores.getScoreAt(row, colGeneId);
+
+                            if(currentScore > bestScore) {
+                                bestScore = currentScore;
+                                currentBestIndexs.clear();
+                                currentBestIndexs.push_back(row);
+                            } else if(currentScore == bestScore && currentScore > 0) {
+                                currentBestIndexs.push_back(row);
+                            }
                         }
-                    }
 
-                    // passa per tutte le righe con il punteggio migliore
-                    // e se quel punteggio è il migliore anche per la riga
-                    // crea il bbh
-
-                    if(bestScore > 0.0) {
-                        index_t currentColGeneFileLine = currentColGene.getGeneFilePosition();
-                        for(auto index = currentBestIndexs.begin(); index != currentBestIndexs.end(); ++index) {
-                            index_t currentIndex = *index;
-
-                            if(bestScore == candidates.getBestScoreForCandidate(currentIndex)) {
-                                fwRef.write(
-                                    std::to_string(
-                                        genes[currentIndex].getGeneFilePosition()
-                                    ) + "," +
-                                    std::to_string(
-                                        currentColGeneFileLine
-                                    ) + "," +
-                                    std::to_string(bestScore)
-                                    , outStream_);
-                                
+                        // passa per tutte le righe con il punteggio migliore
+                        // e se quel punteggio è il migliore anche per la riga
+                        // crea il bbh
+
+                        if(bestScore > 0) {
+                            index_t currentColGeneFileLine = currentColGene.getGeneFilePosition();
+                            score_t exactBestScore = resolveTies(genes, currentColGene, currentBestIndexs);
+                            for(auto index = currentBestIndexs.begin(); index != currentBestIndexs.end(); ++index) {
+                                index_t currentIndex = *index;
+
+                                // il migliore della colonna confrontato con quello esatto della riga
+                                score_t rowBestScore = candidates.getBestScoreForCandidate(currentIndex);
+                                if(exactBestScore == rowBestScore) {
+                                    fwRef.write(
+                                        std::to_string(
+                                            genes[currentIndex].getGeneFilePosition()
+                                        ) + "," +
+                                        std::to_string(
+                                            currentColGeneFileLine
+                                        ) + "," +
+                                        std::to_string(rowBestScore)
+                                        , outStream_);
+
+                                }
                             }
                         }
                     }
@@ -695,7 +726,6 @@ namespace homology {
         while(!poolRef.tasksCompleted()) {
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
-        delete matchp;
     }
     
 }
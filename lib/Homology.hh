@@ -8,21 +8,48 @@
 #include <chrono>
 
 #include "../threads/ThreadPool.hh"
+#include "../threads/TaskGroup.hh"
+#include "../threads/JobScheduler.hh"
 #include "genx/Genome.hh"
 #include "VariablesTypes.hh"
 #include "genx/Gene.hh"
 #include "genx/GenomesContainer.hh"
+#include "genx/ProfileCache.hh"
+#include "genx/ProfileStore.hh"
+#include "Checkpoint.hh"
+#include "RunState.hh"
+#include "PairCache.hh"
+#include "Shard.hh"
 #include "bbh/BBHCandidatesContainer.hh"
 #include "bbh/MinBBHContainer.hh"
+#include "bbh/BestScoresContainer.hh"
+#include "bbh/ColumnHitsContainer.hh"
+#include "bbh/PruningCounters.hh"
+#include "bbh/EdgesContainer.hh"
 #include <cmath>
-#include <unordered_set>
 #include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <cstdio>
+#include <thread>
+#include <exception>
 
 #include "kmers/KmerMapper.hh"
+#include "kmers/DenseKmersProfile.hh"
+#include "kmers/KmersInvertedIndex.hh"
 #include "ScoresContainer.hh"
+#include "SparseScoresContainer.hh"
+#include "TriangularScoresContainer.hh"
+#include "SimilarityKernel.hh"
+#include "BBHEngine.hh"
+#include "PairWorkspace.hh"
 
 #include "./../utils/FileWriter.hh"
 #include "./../utils/StopWatch.hh"
+#include "./../utils/CacheInfo.hh"
+#include "./../utils/MemoryInfo.hh"
 
 
 /**
@@ -42,13 +69,18 @@ namespace homology {
     /**
      * @class Homology
      * @brief Class for computing homology between genomes.
+     *
+     * @tparam K The length of kmers known at compile time (2 <= K <= 8): kmers are packed in integers
+     *         and the terms depending on k are constants. 0 is the generic engine, k is only known at runtime.
      */
+    template<shared::kType K = 0>
     class Homology {
         private:
             
             using k_t = shared::kType;
             using index_t = shared::indexType;
             using score_t = shared::scoreType;
+            using stored_t = shared::storedScoreType;
             using multiplicity_t = shared::multiplicityType;
             using minBBH_t = bbh::MinBBHContainer;
 
@@ -57,6 +89,12 @@ namespace homology {
             using kmersContainer_t = kmers::KmersContainer;
             using kmersContainer_tr = const kmersContainer_t&;
             using kmersSet_tr = const kmersContainer_t::kmerSet_tr;
+            using denseProfile_t = kmers::DenseKmersProfile;
+            using denseProfile_tr = denseProfile_t&;
+            using invertedIndex_t = kmers::KmersInvertedIndex;
+            using invertedIndex_tr = invertedIndex_t&;
+            using accumulator_t = kmers::PostingsAccumulator;
+            using accumulator_tr = accumulator_t&;
 
             using genome_t = genome::Genome;
             using genome_tr = genome_t&;
@@ -66,17 +104,37 @@ namespace homology {
             using gene_tp = gene_t*;
 
             
-            using BBHCandidate_t = bbh::BBHCandidate;
-            using BBHCandidate_tp = BBHCandidate_t*;
-            using BBHCandidate_tr = BBHCandidate_t&;
 
             using BBHcandidatesContainer_t = bbh::BBHCandidatesContainer;
             using BBHcandidatesContainer_tp = BBHcandidatesContainer_t*;
             using BBHcandidatesContainer_tr = BBHcandidatesContainer_t&;
 
+            using bestScores_t = bbh::BestScoresContainer;
+            using bestScores_tr = bestScores_t&;
+            using columnHits_t = bbh::ColumnHitsContainer;
+            using columnHits_tp = columnHits_t*;
+            using columnHits_tr = columnHits_t&;
+            using pairWorkspacePool_t = PairWorkspacePool;
+            using pairWorkspace_tp = PairWorkspace*;
+            using rowsMutexes_t = PairWorkspace::rowsMutexes_t;
+            using rowsMutexes_tr = rowsMutexes_t&;
+            using pruningCounters_t = bbh::PruningCounters;
+            using pruningCounters_tr = pruningCounters_t&;
+            using edges_t = bbh::EdgesContainer;
+            using edges_tr = edges_t&;
+            using hash_t = RunState::hash_t;
+
+            // intervallo [first, second) di posizioni nell'ordine per lunghezza delle colonne
+            using range_t = std::pair<index_t, index_t>;
+            using ranges_t = std::vector<range_t>;
+            using ranges_tr = ranges_t&;
+
             using thread_pt = threads::ThreadPool;
             using thread_ptp = thread_pt*;
             using thread_ptr = thread_pt&;
+            using taskGroup_t = threads::TaskGroup;
+            using scheduler_t = threads::JobScheduler;
+            using log_tr = std::ostringstream&;
             
             
             k_t k_;
@@ -85,34 +143,319 @@ namespace homology {
             thread_ptp pool_;
             std::string inFile_;
             minBBH_t mins_;
+
+            // contenitori delle coppie di genomi, riusati da una coppia all'altra
+            pairWorkspacePool_t workspaces_;
+            // coppie di genomi calcolate contemporaneamente (0 automatico)
+            index_t concurrentPairs_;
+            // byte di kmer che restano in memoria nella modalita' con minor costo in ram (0 nessuna cache)
+            std::size_t profileBudget_;
+            // genomi in memoria insieme nel calcolo a blocchi (0 automatico), se blockTraversal_
+            index_t blockGenomes_;
+            bool blockTraversal_;
+            // cartella del file con i kmer gia' calcolati (vuota nessun file)
+            std::string spillDirectory_;
+            // coppie completate, per riprendere un calcolo interrotto (nullptr senza checkpoint)
+            std::unique_ptr<Checkpoint> checkpoint_;
+            // secondi tra due checkpoint, se checkpointing_
+            index_t checkpointInterval_;
+            bool checkpointing_;
+            bool resume_;
+            // risultati delle coppie, salvati per aggiungere genomi in seguito (nullptr senza stato)
+            std::unique_ptr<RunState> runState_;
+            std::string statePath_;
+            std::string previousStatePath_;
+            // coppie di genomi calcolate da qualsiasi esecuzione (nullptr senza cache)
+            std::unique_ptr<PairCache> pairCache_;
+            std::string pairCacheDirectory_;
+            // shard statico shardIndex_ su shardCount_ (0 nessuno), cartella dei lock del dinamico (vuota nessuno)
+            index_t shardIndex_;
+            index_t shardCount_;
+            std::string shardDirectory_;
+            // output dei processi da unire (vuoto nessuna unione)
+            std::vector<std::string> mergeFiles_;
+            // hash dei geni di ogni genoma, identifica il genoma negli stati e nella cache delle coppie
+            std::vector<hash_t> hashes_;
+            // le righe di log di una coppia vengono stampate insieme, senza mescolarsi
+            std::mutex logMutex_;
             score_t similarityMinVal_;
+            pruningCounters_t totalPruning_;
+
+            // geni per lato di un tile (0 un task per riga), calcolato per ogni coppia se autoTileSize_
+            index_t tileSize_;
+            bool autoTileSize_;
+            SimilarityKernel kernel_;
+            BBHEngine engine_;
             
             /**
-             * @brief Calculates the similarity values for a row using the Generalized Jaccard index.
-             *        Parallel computation is performed by sending each row as a task to the ThreadPool,
-             *        ensuring no concurrency issues.
+             * @brief Calculates the similarity values for the rows using the Generalized Jaccard index.
+             *        Parallel computation is performed by sending each tile (see calculateTiles) as a task to the ThreadPool.
+             *        Each row only visits the range of column genes that passes the length cut.
              * @param rowGenes The genes in the row.
+             * @param rowOrder The row genes sorted by length.
              * @param colGenes The genes in the column.
+             * @param colOrder The column genes sorted by length.
              * @param bestRows The bestRows object containing candidates columns for Bidirectional Best Hit (BBH).
-             * @param scores The container for storing similarity scores.
+             * @param scores The container for storing similarity scores, used only by the matrix engine (else nullptr).
+             * @param triangularScores The container for the scores of a genome with itself, used only by the matrix engine (else nullptr).
+             * @param sparseScores The container for the nonzero similarity scores, used only by the sparse engine (else nullptr).
+             * @param columnHits The scores that reached the best of their column, one slot per tile, used only by the streaming engine (else nullptr).
+             * @param bestRowScores The best score of every row, set to 0 (see PairWorkspace::getBestRowScores).
+             * @param bestCols The best score found so far for every column, used together with the row best
+             *        to skip the pairs that can not become (or tie) a best hit.
+             * @param rowsMutexes The mutexes of the blocks of rows, grown as needed (see PairWorkspace::getRowsMutexes).
+             * @param index The inverted index of the column genes, not built (see PairWorkspace::getInvertedIndex).
+             * @param counters The counters of discarded, pruned, aborted and computed pairs.
              */
             inline void calculateRow(
-                genome_t::gene_ctr rowGenes, genome_t::gene_ctr colGenes,
-                BBHcandidatesContainer_tr bestRows, ScoresContainer& scores
+                genome_t::gene_ctr rowGenes, genome_t::order_ctr rowOrder,
+                genome_t::gene_ctr colGenes, genome_t::order_ctr colOrder,
+                BBHcandidatesContainer_tr bestRows, ScoresContainer* scores, TriangularScoresContainer* triangularScores, SparseScoresContainer* sparseScores, columnHits_tp columnHits,
+                bestScores_tr bestRowScores, bestScores_tr bestCols, rowsMutexes_tr rowsMutexes, invertedIndex_tr index, pruningCounters_tr counters
             ) const;
 
             
             /**
-             * @brief Calculates the similarity values for a row using the Generalized Jaccard index.
-             *        Parallel computation is performed by sending each row as a task to the ThreadPool,
-             *        ensuring no concurrency issues. This function is specialized for cases where the genome
+             * @brief Calculates the similarity values for the rows using the Generalized Jaccard index.
+             *        Parallel computation is performed by sending each tile (see calculateTiles) as a task to the ThreadPool.
+             *        This function is specialized for cases where the genome
              *        is the same, resulting in fewer comparisons to be made.
+             *        Each row only visits the range of genes that passes the length cut.
              * @param colGene The genes in the column.
+             * @param order The genes sorted by length.
              * @param bestRows The bestRows object containing candidates columns for Bidirectional Best Hit (BBH).
-             * @param scores The container for storing similarity scores.
+             * @param scores The container for storing similarity scores, used only by the matrix engine (else nullptr).
+             * @param triangularScores The container for the scores of a genome with itself, used only by the matrix engine (else nullptr).
+             * @param sparseScores The container for the nonzero similarity scores, used only by the sparse engine (else nullptr).
+             * @param columnHits The scores that reached the best of their column, one slot per tile, used only by the streaming engine (else nullptr).
+             * @param bestRowScores The best score of every row, set to 0 (see PairWorkspace::getBestRowScores).
+             * @param bestCols The best score found so far for every column, used together with the row best
+             *        and the genome minimum to skip the pairs that can not become (or tie) a best hit.
+             * @param rowsMutexes The mutexes of the blocks of rows, grown as needed (see PairWorkspace::getRowsMutexes).
+             * @param index The inverted index of the genes, not built (see PairWorkspace::getInvertedIndex).
+             * @param counters The counters of discarded, pruned, aborted and computed pairs.
+             */
+            inline void calculateRowSame(index_t genomeId, genome_t::gene_ctr colGene, genome_t::order_ctr order,
+            BBHcandidatesContainer_tr bestRows, ScoresContainer* scores, TriangularScoresContainer* triangularScores, SparseScoresContainer* sparseScores, columnHits_tp columnHits,
+            bestScores_tr bestRowScores, bestScores_tr bestCols, rowsMutexes_tr rowsMutexes, invertedIndex_tr index, pruningCounters_tr counters) const;
+
+            /**
+             * @brief Chooses the tile size for a genome pair: a block of row genes and a block of column
+             *        genes whose profiles fit together in half of the L2 cache, while leaving enough tiles
+             *        to keep every thread busy.
+             * @param rowGenes The genes in the row.
+             * @param colGenes The genes in the column.
+             * @return The number of row genes and of column genes of a tile.
+             */
+            inline range_t calculateTileSize(genome_t::gene_ctr rowGenes, genome_t::gene_ctr colGenes) const;
+
+            /**
+             * @brief Splits the score matrix in tiles and sends each tile as a task to the ThreadPool, then
+             *        waits for all of them. Rows and columns are taken in length order, so the compatible ranges
+             *        form a band and the tiles outside the band are not sent at all.
+             *        With a tile size of 0 every row is a task with all the columns (the previous scheme).
+             * @param rowGenes The genes in the row.
+             * @param rowOrder The row genes sorted by length.
+             * @param colGenes The genes in the column.
+             * @param colOrder The column genes sorted by length.
+             * @param minScore Scores lower than minScore are not stored.
+             * @param triangular True if rows and columns are the same genome, only col > row is computed.
+             * @param bestRows The bestRows object containing candidates columns for Bidirectional Best Hit (BBH).
+             * @param scores The container for storing similarity scores, used only by the matrix engine (else nullptr).
+             * @param triangularScores The container for the scores of a genome with itself, used only by the matrix engine (else nullptr).
+             * @param sparseScores The container for the nonzero similarity scores, used only by the sparse engine (else nullptr).
+             * @param columnHits The scores that reached the best of their column, one slot per tile, used only by the streaming engine (else nullptr).
+             * @param bestRowScores The best score of every row, set to 0, reused from the previous pairs.
+             * @param bestCols The best score found so far for every column.
+             * @param rowsMutexes The mutexes of the blocks of rows, grown to the blocks of the pair.
+             * @param index The inverted index of the column genes, built only if its kernel is used.
+             * @param counters The counters of discarded, pruned, aborted and computed pairs.
+             */
+            inline void calculateTiles(
+                genome_t::gene_ctr rowGenes, genome_t::order_ctr rowOrder,
+                genome_t::gene_ctr colGenes, genome_t::order_ctr colOrder,
+                const score_t minScore, const bool triangular,
+                BBHcandidatesContainer_tr bestRows, ScoresContainer* scores, TriangularScoresContainer* triangularScores, SparseScoresContainer* sparseScores, columnHits_tp columnHits,
+                bestScores_tr bestRowScores, bestScores_tr bestCols, rowsMutexes_tr rowsMutexes, invertedIndex_tr index, pruningCounters_tr counters
+            ) const;
+
+            /**
+             * @brief Computes one tile: the row genes at positions rowPositions of rowOrder against the column genes
+             *        at positions colPositions of colOrder. The best columns of each row are collected locally
+             *        and merged into bestRows under rowsMutex, since other tiles may share the same rows.
+             *        With the streaming engine the scores that reach the current best of their column (kept lock free
+             *        in bestCols) are appended to the slot of the tile in columnHits, without locks.
+             * @param rowGenes The genes in the row.
+             * @param rowOrder The row genes sorted by length.
+             * @param rowPositions The [first, second) positions of rowOrder of the tile.
+             * @param colGenes The genes in the column.
+             * @param colOrder The column genes sorted by length.
+             * @param colPositions The [first, second) positions of colOrder of the tile.
+             * @param ranges The compatible ranges of every row (see calculateCompatibleRanges).
+             * @param vocabularySize Greatest kmer id of the two genomes + 1, used by the scatter/gather kernel.
+             * @param kernel The kernel used to compute the scores, never SimilarityKernel::automatic.
+             * @param index The inverted index of the column genes, used by the inverted index kernel.
+             * @param minScore Scores lower than minScore are not stored.
+             * @param triangular True if rows and columns are the same genome, only col > row is computed.
+             * @param bestRows The bestRows object containing candidates columns for Bidirectional Best Hit (BBH).
+             * @param scores The container for storing similarity scores, used only by the matrix engine (else nullptr).
+             * @param triangularScores The container for the scores of a genome with itself, used only by the matrix engine (else nullptr).
+             * @param sparseScores The container for the nonzero similarity scores, used only by the sparse engine (else nullptr).
+             * @param columnHits The scores that reached the best of their column, one slot per tile, used only by the streaming engine (else nullptr).
+             * @param bestRowScores The best score found so far for every row, shared between the tiles of a row.
+             * @param bestCols The best score found so far for every column.
+             * @param rowsMutex The mutex of the row block of the tile.
+             * @param tileSlot The slot of the tile in columnHits.
+             * @param counters The counters of pruned, aborted and computed pairs.
+             */
+            inline void calculateTile(
+                genome_t::gene_ctr rowGenes, genome_t::order_ctr rowOrder, const range_t rowPositions,
+                genome_t::gene_ctr colGenes, genome_t::order_ctr colOrder, const range_t colPositions,
+                const ranges_t& ranges, const index_t vocabularySize,
+                const SimilarityKernel kernel, const invertedIndex_t& index,
+                const score_t minScore, const bool triangular,
+                BBHcandidatesContainer_tr bestRows, ScoresContainer* scores, TriangularScoresContainer* triangularScores, SparseScoresContainer* sparseScores, columnHits_tp columnHits,
+                bestScores_tr bestRowScores, bestScores_tr bestCols,
+                std::mutex& rowsMutex, const index_t tileSlot, pruningCounters_tr counters
+            ) const;
+
+            /**
+             * @brief Chooses the kernel for a genome pair. A deterministic sample of row genes (evenly spaced in
+             *        length order) and of their compatible column genes is scored with every kernel, the time per
+             *        pair and per row is extrapolated to all the compatible pairs and the fastest kernel is taken.
+             *        The estimates, the profile sizes and the overlap density of the sample are logged.
+             * @param rowGenes The genes in the row.
+             * @param rowOrder The row genes sorted by length.
+             * @param colGenes The genes in the column.
+             * @param colOrder The column genes sorted by length.
+             * @param ranges The compatible ranges of every row (see calculateCompatibleRanges).
+             * @param triangular True if rows and columns are the same genome.
+             * @param vocabularySize Greatest kmer id of the two genomes + 1.
+             * @param index Built on the column genes, it can be reused if the inverted index kernel is chosen.
+             * @return The fastest kernel.
+             */
+            inline SimilarityKernel planSimilarityKernel(
+                genome_t::gene_ctr rowGenes, genome_t::order_ctr rowOrder,
+                genome_t::gene_ctr colGenes, genome_t::order_ctr colOrder,
+                const ranges_t& ranges, const bool triangular,
+                const index_t vocabularySize, invertedIndex_tr index
+            ) const;
+
+            /**
+             * @brief The dense profile of the calling thread, shared by the scatter/gather kernel and the planner.
+             * @return The profile of the thread.
+             */
+            static inline denseProfile_tr getThreadProfile();
+
+            /**
+             * @brief The postings accumulator of the calling thread, used by the inverted index kernel and the planner.
+             * @return The accumulator of the thread.
+             */
+            static inline accumulator_tr getThreadAccumulator();
+
+            /**
+             * @brief The log of the genome pair computed by the calling thread, printed by flushPairLog.
+             * @return The log of the thread.
+             */
+            static inline log_tr getPairLog();
+
+            /**
+             * @brief Prints and empties the log of the calling thread, without mixing it with the logs of the other pairs.
+             */
+            inline void flushPairLog();
+
+            /**
+             * @brief Number of genome pairs computed at the same time.
+             * @param pairs Number of pairs to compute.
+             * @return The pairs set by setConcurrentPairs or, if 0, one per thread with the streaming engine
+             *         (memory linear in the genes) and 1 with the engines storing the scores; at most pairs.
              */
-            inline void calculateRowSame(index_t genomeId, genome_t::gene_ctr colGene, 
-            BBHcandidatesContainer_tr bestRows, ScoresContainer& scores) const;
+            inline index_t getConcurrentPairs(const index_t pairs) const;
+
+            /**
+             * @brief Checks if a pair has been completed before the run was interrupted (see setCheckpoint).
+             * @param row The id of the row genome.
+             * @param col The id of the column genome (row for a genome with itself).
+             * @return True if the pair is in the resumed checkpoint.
+             */
+            inline bool isCompleted(const index_t row, const index_t col) const;
+
+            /**
+             * @brief Checks if the kmers of two genomes are not needed to compare them: the pair has been completed
+             *        before the run was interrupted, is in the previous run state or in the pair cache.
+             * @param row The row genome.
+             * @param col The column genome.
+             * @return True if the pair is not computed.
+             */
+            inline bool isReused(genome_tr row, genome_tr col) const;
+
+            /**
+             * @brief Writes the BBH of a completed pair to the output as a single block, recorded by the checkpoint
+             *        and by the run state if any.
+             * @param rowGenome The row genome.
+             * @param colGenome The column genome (rowGenome for a genome with itself).
+             * @param min The minimum BBH score of the pair.
+             * @param edges The BBH of the pair.
+             * @param output Buffer for the lines of the pair.
+             */
+            inline void writePair(genome_tr rowGenome, genome_tr colGenome, const score_t min, edges_tr edges, std::string& output);
+
+            /**
+             * @brief Loads the previous run state if any and starts the new one.
+             * @param genomes The genomes.
+             */
+            inline void startRunState(genome::GenomesContainer::genome_ctr genomes);
+
+            /**
+             * @brief Creates the checkpoint and, when resuming, restores the completed pairs and their minimums.
+             * @param genomes The genomes.
+             */
+            inline void startCheckpoint(genome::GenomesContainer::genome_ctr genomes);
+
+            /**
+             * @brief The mode with lower RAM cost with the kmers kept in a ProfileCache of profileBudget_ bytes.
+             *        The rows are visited in order and the columns of a row in the opposite direction of the
+             *        previous row (serpentine order): the first columns of a row are the last ones of the previous
+             *        row, the most likely to be still resident. A row genome is evicted after its last pair.
+             * @param genomes The genomes.
+             */
+            inline void calculateWithProfileCache(genome::GenomesContainer::genome_ctr genomes);
+
+            /**
+             * @brief Block nested loop over the genomes: the kmers of a block of genomes stay in memory while
+             *        the pairs inside the block are computed, then every following genome is loaded once and
+             *        compared with the whole block. The kmers are computed O(G^2 / B) times instead of O(G^2)
+             *        as in the mode with lower RAM cost. After the pass of a block the minimums of its genomes
+             *        are final, so each of them is compared with itself before being evicted.
+             *        With blockGenomes_ = 0 a block grows while its kmers, the mapper vocabulary (see ProfileCache),
+             *        the kmers of the next genome and those of a streamed genome fit in profileBudget_, or in half
+             *        of the available memory if 0.
+             * @param genomes The genomes.
+             */
+            inline void calculateByBlocks(genome::GenomesContainer::genome_ctr genomes);
+
+            /**
+             * @brief Computes the pairs of different genomes of this process (see Shard and setShard), then saves
+             *        their minimums next to the output. The kmers of the genomes of a batch are acquired from a
+             *        ProfileCache of profileBudget_ bytes, or of half of the available memory if 0.
+             * @param genomes The genomes.
+             */
+            inline void calculateShard(genome::GenomesContainer::genome_ctr genomes);
+
+            /**
+             * @brief Concatenates the outputs of the processes, reduces their minimums and compares every genome
+             *        with itself: the output is that of a whole run.
+             * @param genomes The genomes.
+             */
+            inline void calculateMerge(genome::GenomesContainer::genome_ctr genomes);
+
+            /**
+             * @brief Size of the dense array needed to address every kmer of the two genomes.
+             * @param rowGenes The genes in the row.
+             * @param colGenes The genes in the column.
+             * @return The greatest kmer id + 1.
+             */
+            inline index_t calculateVocabularySize(genome_t::gene_ctr rowGenes, genome_t::gene_ctr colGenes) const;
 
             /**
              * @brief Extracts Bidirectional Best Hits (BBH) using the similarity values calculated by calculateRow.
@@ -120,47 +463,222 @@ namespace homology {
              * @param rowGenes The genes in the row.
              * @param candidates The container of BBH candidates (bestRows param.of calculateRow).
              * @param scores The container for storing similarity scores.
+             * @param edges The BBH found, written to the output when the pair is complete.
              */
             inline score_t
             checkForBBH(
                 const genome_t::gene_ctr colGenes,
                 const genome_t::gene_ctr rowGenes,
                 BBHcandidatesContainer_tr candidates,
-                ScoresContainer& scores
+                ScoresContainer& scores,
+                edges_tr edges
             );
             
+            /**
+             * @brief Extracts Bidirectional Best Hits (BBH) from the column hits collected by the streaming engine:
+             *        a hit is a BBH if its score is greater than 0 and equal to both the final best of its column
+             *        and the best score of its row. Used for both different genomes and the same genome.
+             * @param candidates The best columns of every row.
+             * @param bestCols The final best score of every column.
+             * @param columnHits The hits of every tile.
+             * @param edges The BBH found, written to the output when the pair is complete.
+             * @return The lowest score of the BBH found, 2 if there are none.
+             */
+            inline score_t
+            checkForBBH(
+                BBHcandidatesContainer_tr candidates,
+                const bestScores_t& bestCols,
+                columnHits_tr columnHits,
+                edges_tr edges
+            );
+
+            /**
+             * @brief Extracts Bidirectional Best Hits (BBH) from the nonzero scores collected by the sparse engine,
+             *        walking each compressed column once. Used for both different genomes and the same genome
+             *        (the columns of the same genome hold only the rows before the diagonal).
+             * @param colGenes The genes in the column.
+             * @param rowGenes The genes in the row.
+             * @param candidates The best columns of every row.
+             * @param scores The compressed nonzero scores.
+             * @param edges The BBH found, written to the output when the pair is complete.
+             * @return The lowest score of the BBH found, 2 if there are none.
+             */
+            inline score_t
+            checkForBBH(
+                const genome_t::gene_ctr colGenes,
+                const genome_t::gene_ctr rowGenes,
+                BBHcandidatesContainer_tr candidates,
+                const SparseScoresContainer& scores,
+                edges_tr edges
+            );
+
             /**
              * @brief Extracts Bidirectional Best Hits (BBH) using the similarity values calculated by calculateRowSame.
              * @param genes The genes for which to extract BBH.
              * @param candidates The container of BBH candidates (bestRows param.of calculateRow).
-             * @param scores The container for storing similarity scores.
+             * @param scores The container storing the similarity scores of the pairs row < col.
+             * @param edges The BBH found, written to the output when the pair is complete.
              */
             inline void
             checkForBBHSame(
                 const genome_t::gene_ctr genes,
                 BBHcandidatesContainer_tr candidates,
-                ScoresContainer& scores
+                const TriangularScoresContainer& scores,
+                edges_tr edges
             );
 
             
+            /**
+             * @brief The length of kmers, a constant when K is not 0.
+             * @return The length of kmers.
+             */
+            inline k_t getK() const noexcept;
+
+            /**
+             * @brief Minimum fraction of shared kmers of a gene for a non zero score, 1/(2k).
+             * @return The minimum fraction, a constant when K is not 0.
+             */
+            inline score_t getSimilarityMinVal() const noexcept;
+
+            /**
+             * @brief Checks if the pair is excluded by the length cut (-d).
+             * @param gene1 The first gene.
+             * @param gene2 The second gene.
+             * @return True if one gene is shorter than the cut of the other.
+             */
+            inline bool
+            isDiscarded(const gene_tr gene1, const gene_tr gene2) const;
+
+            /**
+             * @brief Computes, for every row gene, the range of column genes (positions in colOrder)
+             *        that passes the length cut: isDiscarded is false exactly inside the range.
+             *        Rows are visited by increasing length, so both ends of the range only move forward.
+             * @param rowGenes The genes in the row.
+             * @param rowOrder The row genes sorted by length.
+             * @param colGenes The genes in the column.
+             * @param colOrder The column genes sorted by length.
+             * @param ranges Filled with one range per row gene, indexed by row gene index.
+             */
+            inline void
+            calculateCompatibleRanges(
+                genome_t::gene_ctr rowGenes, genome_t::order_ctr rowOrder,
+                genome_t::gene_ctr colGenes, genome_t::order_ctr colOrder,
+                ranges_tr ranges
+            ) const;
+
+            /**
+             * @brief Upper bound of the Generalized Jaccard index of two genes, computed from the total
+             *        multiplicities only: sum(min) <= min(|A|,|B|) and sum(max) >= max(|A|,|B|).
+             * @param gene1 The first gene.
+             * @param gene2 The second gene.
+             * @return min(|A|,|B|)/max(|A|,|B|), never lower than the real score.
+             */
+            inline score_t
+            calculateUpperBound(const gene_tr gene1, const gene_tr gene2) const;
+
+            /**
+             * @brief Selects the engine of a genome pair. The matrix engines store the scores encoded by
+             *        ScoreCodec, whose equal codes are equal scores only while the denominators are small
+             *        (see ScoreCodec::isExact): the pairs with larger genes use the streaming engine instead.
+             * @param rowGenes The genes of the row genome, with their kmers.
+             * @param colGenes The genes of the column genome, with their kmers.
+             * @return The engine of the pair.
+             */
+            inline BBHEngine getPairEngine(genome_t::gene_ctr rowGenes, genome_t::gene_ctr colGenes) const;
+
             /**
              * @brief Calculates the similarity between two genes using the Generalized Jaccard index.
              *        This function is used for initial filtering based on the total multiplicity of genes.
              * @param gene1 The first gene.
              * @param gene2 The second gene.
+             * @param threshold Scores lower than threshold are useless to the caller, the merge can stop as soon as
+             *        the score can not reach it (0 computes every score).
+             * @param aborted Set to true if the merge stopped early, in this case the returned score is 0.
              * @return The similarity score between the two genes.
              */
             inline score_t
-            calculateSimilarity(const gene_tr gene1, const gene_tr gene2) const;
+            calculateSimilarity(const gene_tr gene1, const gene_tr gene2, const score_t threshold, bool& aborted) const;
             
             /**
              * @brief Calculates the similarity between two kmers containers using the Jaccard index.
              * @param gene1Container The kmers container of the first gene.
              * @param gene2Container The kmers container of the second gene.
+             * @param threshold Scores lower than threshold are useless to the caller (0 computes every score).
+             * @param aborted Set to true if the merge stopped early, in this case the returned score is 0.
              * @return The similarity score between the two kmers containers.
              */
             inline score_t
-            calculateSimilarity(kmersContainer_tr gene1Container, kmersContainer_tr gene2Container) const;
+            calculateSimilarity(kmersContainer_tr gene1Container, kmersContainer_tr gene2Container, const score_t threshold, bool& aborted) const;
+
+            /**
+             * @brief Calculates the similarity between two genes using the Generalized Jaccard index, reading the kmers
+             *        of the column gene from the dense profile of the row gene (scatter/gather kernel).
+             *        The score is the same of the merge kernel.
+             * @param rowProfile The dense profile where rowGene has been scattered.
+             * @param rowGene The row gene.
+             * @param colGene The column gene.
+             * @param threshold Scores lower than threshold are useless to the caller (0 computes every score).
+             * @param aborted Set to true if the gather stopped early, in this case the returned score is 0.
+             * @return The similarity score between the two genes.
+             */
+            inline score_t
+            calculateSimilarity(const denseProfile_tr rowProfile, const gene_tr rowGene, const gene_tr colGene, const score_t threshold, bool& aborted) const;
+
+            /**
+             * @brief Calculates the similarity between two genes using the Generalized Jaccard index, walking the
+             *        genes with fewer kmers and searching each kmer in the other one by galloping (exponential search
+             *        followed by binary search). The score is the same of the merge kernel.
+             * @param gene1 The first gene.
+             * @param gene2 The second gene.
+             * @param threshold Scores lower than threshold are useless to the caller (0 computes every score).
+             * @param aborted Set to true if the search stopped early, in this case the returned score is 0.
+             * @return The similarity score between the two genes.
+             */
+            inline score_t
+            calculateSimilarityGalloping(const gene_tr gene1, const gene_tr gene2, const score_t threshold, bool& aborted) const;
+
+            /**
+             * @brief Calculates the similarity between two genes using the Generalized Jaccard index, from the
+             *        intersections accumulated by the inverted index kernel. The score is the same of the merge kernel.
+             * @param accumulator The accumulator where the postings of rowGene have been accumulated.
+             * @param rowGene The row gene.
+             * @param colGene The column gene.
+             * @param col The index of colGene in the inverted index.
+             * @return The similarity score between the two genes.
+             */
+            inline score_t
+            calculateSimilarity(const accumulator_t& accumulator, const gene_tr rowGene, const gene_tr colGene, const index_t col) const;
+
+            /**
+             * @brief Calculates the similarity between two genes with the given kernel. The row gene must already be
+             *        scattered in rowProfile (scatter/gather) or accumulated in accumulator (inverted index).
+             * @param kernel The kernel, never SimilarityKernel::automatic.
+             * @param rowProfile The dense profile of the thread.
+             * @param accumulator The postings accumulator of the thread.
+             * @param rowGene The row gene.
+             * @param colGene The column gene.
+             * @param col The index of colGene in its genome.
+             * @param threshold Scores lower than threshold are useless to the caller (0 computes every score).
+             * @param aborted Set to true if the kernel stopped early, in this case the returned score is 0.
+             * @return The similarity score between the two genes.
+             */
+            inline score_t
+            calculateKernelSimilarity(
+                const SimilarityKernel kernel, const denseProfile_tr rowProfile, const accumulator_t& accumulator,
+                const gene_tr rowGene, const gene_tr colGene, const index_t col,
+                const score_t threshold, bool& aborted
+            ) const;
+
+            /**
+             * @brief Smallest sum of the intersection minima (num) that gives a score >= threshold.
+             *        The score is num/(total - num), so it grows with num.
+             * @param total Sum of the multiplicities of the two genes.
+             * @param maxIntersection Greatest possible num, min of the two multiplicities.
+             * @param threshold The score to reach.
+             * @return The minimum num, maxIntersection + 1 if threshold can not be reached.
+             */
+            inline std::size_t
+            calculateMinIntersection(const std::size_t total, const std::size_t maxIntersection, const score_t threshold) const;
 
             /**
              * @brief Calculates Bidirectional Best Hits (BBH) between genes of different genomes.
@@ -192,6 +710,112 @@ namespace homology {
              * @param fileName The name of the output file.
              */
             inline explicit Homology(k_t k, std::string fileName);
+
+            /**
+             * @brief Sets the number of genes per side of a tile, the work unit sent to the ThreadPool.
+             *        0 sends one task per row gene, by default the size is chosen from the L2 cache size.
+             * @param tileSize The number of genes per side.
+             */
+            inline void setTileSize(const index_t tileSize);
+
+            /**
+             * @brief Sets the kernel used to compute the similarity of two genes
+             *        (SimilarityKernel::automatic by default, chosen for every genome pair).
+             * @param kernel The kernel.
+             */
+            inline void setSimilarityKernel(const SimilarityKernel kernel);
+
+            /**
+             * @brief Sets the engine used to extract the Bidirectional Best Hits (BBH::streaming by default).
+             * @param engine The engine.
+             */
+            inline void setBBHEngine(const BBHEngine engine);
+
+            /**
+             * @brief Sets the number of genome pairs computed at the same time, the largest first (0 automatic, by default).
+             *        Every pair waits only for its own tasks, so while a pair is at a barrier the others keep the threads busy.
+             *        The mode with lower RAM cost keeps the kmers of two genomes at a time and computes the pairs one by one.
+             * @param pairs The number of pairs.
+             */
+            inline void setConcurrentPairs(const index_t pairs);
+
+            /**
+             * @brief Sets the memory for the kmers of the genomes in the mode with lower RAM cost (0, by default, keeps
+             *        the kmers of two genomes at a time). The kmers of the genomes already compared stay in memory
+             *        while they fit, so they are not computed again for the next pairs.
+             * @param bytes The number of bytes.
+             */
+            inline void setProfileBudget(const std::size_t bytes);
+
+            /**
+             * @brief Computes the pairs by blocks of genomes whose kmers stay in memory together (see calculateByBlocks),
+             *        instead of the mode selected in calculateBidirectionalBestHit.
+             * @param genomes The number of genomes of a block (0 derived from the memory budget).
+             */
+            inline void setBlockGenomes(const index_t genomes);
+
+            /**
+             * @brief Spills the kmers of every genome to a file after their computation (see genome::ProfileStore) in the
+             *        mode with lower RAM cost and in the computation by blocks: a genome needed again is mapped instead
+             *        of computed again, and the memory budget bounds the mapped kmers too.
+             * @param directory The directory of the file, on a local disk (empty, by default, no file).
+             */
+            inline void setSpillDirectory(const std::string& directory);
+
+            /**
+             * @brief Records the completed genome pairs in a checkpoint next to the output, saved every interval seconds
+             *        (see Checkpoint). A resumed run truncates the output to the last checkpoint and skips its pairs.
+             * @param interval Seconds between two checkpoints (0 after every pair).
+             * @param resume True to resume from the checkpoint of an interrupted run, if present.
+             */
+            inline void setCheckpoint(const index_t interval, const bool resume);
+
+            /**
+             * @brief Saves the BBH and the minimum of every pair in a run state (see RunState), so that genomes
+             *        can be added later without computing the pairs of the genomes already present.
+             * @param path The file of the state, replaced at the end of the run.
+             */
+            inline void setRunState(const std::string& path);
+
+            /**
+             * @brief Takes from the state of a previous run the pairs of genomes present in both runs and the
+             *        comparisons of the genomes with themselves whose minimum has not changed: only the pairs
+             *        with the added genomes are computed and the output is that of a whole run.
+             *        The state of this run is saved too, to the file of setRunState or over the previous one.
+             * @param path The file of the previous state.
+             */
+            inline void setPreviousRunState(const std::string& path);
+
+            /**
+             * @brief Reads the pairs of different genomes from a cache shared by the runs (see PairCache) and writes
+             *        there the computed ones: a dataset made of genomes already compared by other runs, with the same
+             *        k and discard value, computes only the pairs with the new genomes.
+             * @param directory The directory of the cache (empty, by default, no cache).
+             */
+            inline void setPairCache(const std::string& directory);
+
+            /**
+             * @brief Computes only the pairs of different genomes of a static shard, balanced by the genes of the
+             *        genomes. The output holds the lines of those pairs and output.min their minimums, the
+             *        comparisons of the genomes with themselves are left to the merge (see addMergeFile).
+             * @param index The index of the shard, from 0 to count - 1.
+             * @param count The number of shards.
+             */
+            inline void setShard(const index_t index, const index_t count);
+
+            /**
+             * @brief Computes the batches of pairs of different genomes claimed through lock files in a directory
+             *        shared by the processes of the run, until no batch is left. The output is that of setShard.
+             * @param directory The directory of the lock files, empty at the start of the run.
+             */
+            inline void setShardDirectory(const std::string& directory);
+
+            /**
+             * @brief Adds the output of a shard to merge: instead of computing the pairs, the outputs are
+             *        concatenated, their minimums reduced and the genomes compared with themselves.
+             * @param file The output file of the shard, with its minimums in file.min.
+             */
+            inline void addMergeFile(const std::string& file);
             
             Homology(const Homology&) = delete;
             Homology operator=(const Homology&) = delete;
@@ -216,55 +840,357 @@ namespace homology {
             inline void calculateBidirectionalBestHit(genome::GenomesContainer& g, bool mode);
     };
 
+    template<shared::kType K>
     inline
-    Homology::Homology(k_t k, std::string fileName, ushort threadNumber) 
-    : k_(k), similarityMinVal_(1.0/(k*2.0)){
+    Homology<K>::Homology(k_t k, std::string fileName, ushort threadNumber) 
+    : k_(k), concurrentPairs_(0), profileBudget_(0), blockGenomes_(0), blockTraversal_(false), checkpointInterval_(0), checkpointing_(false), resume_(false), shardIndex_(0), shardCount_(0), similarityMinVal_(1.0/(k*2.0)), tileSize_(0), autoTileSize_(true), kernel_(SimilarityKernel::automatic), engine_(BBHEngine::streaming){
         if(k <= 0)
             throw std::runtime_error("k <= 0");
+        if(K != 0 && k != K)
+            throw std::runtime_error("k != K");
         pool_ = new thread_pt(threadNumber);
         pool_->start();
         fw = new utilities::FileWriter("", fileName, ".net", false);
         outStream_ = fw->openAppend();
     }
 
+    template<shared::kType K>
     inline
-    Homology::Homology(k_t k, std::string fileName)
-    : k_(k), similarityMinVal_(1.0/(k*2.0)){
+    Homology<K>::Homology(k_t k, std::string fileName)
+    : k_(k), concurrentPairs_(0), profileBudget_(0), blockGenomes_(0), blockTraversal_(false), checkpointInterval_(0), checkpointing_(false), resume_(false), shardIndex_(0), shardCount_(0), similarityMinVal_(1.0/(k*2.0)), tileSize_(0), autoTileSize_(true), kernel_(SimilarityKernel::automatic), engine_(BBHEngine::streaming){
         if(k <= 0)
             throw std::runtime_error("k <= 0");
+        if(K != 0 && k != K)
+            throw std::runtime_error("k != K");
         pool_ = new thread_pt();
         pool_->start();
         fw = new utilities::FileWriter("", fileName, ".net", false);
         outStream_ = fw->openAppend();
     }
 
+    template<shared::kType K>
+    inline void
+    Homology<K>::setTileSize(const index_t tileSize) {
+        tileSize_ = tileSize;
+        autoTileSize_ = false;
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::setSimilarityKernel(const SimilarityKernel kernel) {
+        kernel_ = kernel;
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::setBBHEngine(const BBHEngine engine) {
+        engine_ = engine;
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::setConcurrentPairs(const index_t pairs) {
+        concurrentPairs_ = pairs;
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::setProfileBudget(const std::size_t bytes) {
+        profileBudget_ = bytes;
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::setBlockGenomes(const index_t genomes) {
+        blockGenomes_ = genomes;
+        blockTraversal_ = true;
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::setSpillDirectory(const std::string& directory) {
+        spillDirectory_ = directory;
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::setCheckpoint(const index_t interval, const bool resume) {
+        checkpointInterval_ = interval;
+        checkpointing_ = true;
+        resume_ = resume;
+    }
+
+    template<shared::kType K>
+    inline bool
+    Homology<K>::isCompleted(const index_t row, const index_t col) const {
+        return checkpoint_ && checkpoint_->isCompleted(row, col);
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::setRunState(const std::string& path) {
+        statePath_ = path;
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::setPreviousRunState(const std::string& path) {
+        previousStatePath_ = path;
+        if(statePath_.empty())
+            statePath_ = path;
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::setPairCache(const std::string& directory) {
+        pairCacheDirectory_ = directory;
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::setShard(const index_t index, const index_t count) {
+        shardIndex_ = index;
+        shardCount_ = count;
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::setShardDirectory(const std::string& directory) {
+        shardDirectory_ = directory;
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::addMergeFile(const std::string& file) {
+        mergeFiles_.push_back(file);
+    }
+
+    template<shared::kType K>
+    inline bool
+    Homology<K>::isReused(genome_tr row, genome_tr col) const {
+        return
+            isCompleted(row.getId(), col.getId()) ||
+            (runState_ && runState_->hasPair(hashes_[row.getId()], hashes_[col.getId()])) ||
+            (pairCache_ && pairCache_->contains(hashes_[row.getId()], hashes_[col.getId()], row.size(), col.size()));
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::writePair(genome_tr rowGenome, genome_tr colGenome, const score_t min, edges_tr edges, std::string& output) {
+        genome_t::gene_ctr rowGenes = rowGenome.getGenes();
+        genome_t::gene_ctr colGenes = colGenome.getGenes();
+        const RunState::edges_t& pairEdges = edges.getEdges();
+        for(auto edge = pairEdges.begin(); edge != pairEdges.end(); ++edge)
+            output +=
+                std::to_string(rowGenes[edge->row].getGeneFilePosition()) + "," +
+                std::to_string(colGenes[edge->col].getGeneFilePosition()) + "," +
+                std::to_string(edge->score) + "\n";
+
+        index_t row = rowGenome.getId(), col = colGenome.getId();
+        if(checkpoint_)
+            checkpoint_->complete(row, col, min, output, outStream_);
+        else
+            fw->writeLines(output, outStream_);
+
+        if(runState_) {
+            if(row == col)
+                runState_->addGenome(hashes_[row], min, pairEdges);
+            else
+                runState_->addPair(hashes_[row], hashes_[col], min, pairEdges);
+        }
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::startRunState(genome::GenomesContainer::genome_ctr genomes) {
+        runState_.reset(new RunState(getK(), shared::cut));
+
+        std::vector<index_t> genes;
+        for(auto genome = genomes.begin(); genome != genomes.end(); ++genome)
+            genes.push_back(genome->size());
+
+        if(!previousStatePath_.empty()) {
+            runState_->load(previousStatePath_);
+            std::cerr<<"\nPrevious run state: "<<runState_->getPreviousGenomesNumber()<<" genomes";
+        }
+        runState_->create(statePath_, hashes_, genes);
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::startCheckpoint(genome::GenomesContainer::genome_ctr genomes) {
+        // il checkpoint vale solo per gli stessi genomi, k e scarto
+        index_t genes = 0;
+        for(auto genome = genomes.begin(); genome != genomes.end(); ++genome)
+            genes += genome->size();
+        char discard[64];
+        std::snprintf(discard, sizeof(discard), "%a", shared::cut);
+        std::string signature =
+            "genomes " + std::to_string(genomes.size()) + " genes " + std::to_string(genes) +
+            " k " + std::to_string(getK()) + " discard " + discard;
+
+        checkpoint_.reset(new Checkpoint(fw->getFileName(), signature, checkpointInterval_));
+        if(resume_) {
+            index_t resumed = checkpoint_->resume();
+            checkpoint_->forEachCompleted(
+                [this](const index_t row, const index_t col, const score_t min) {
+                    if(row != col)
+                        mins_.setVal(row, col, min);
+                }
+            );
+            std::cerr<<"\nResumed pairs: "<<resumed;
+        }
+        checkpoint_->start();
+    }
+
+    template<shared::kType K>
+    inline typename Homology<K>::index_t
+    Homology<K>::getConcurrentPairs(const index_t pairs) const {
+        index_t concurrent = concurrentPairs_;
+        if(concurrent == 0)
+            concurrent = engine_ == BBHEngine::streaming ? pool_->getTotalThread() : 1;
+        concurrent = concurrent < pairs ? concurrent : pairs;
+        return concurrent == 0 ? 1 : concurrent;
+    }
+
+    template<shared::kType K>
+    inline typename Homology<K>::log_tr
+    Homology<K>::getPairLog() {
+        static thread_local std::ostringstream log;
+        return log;
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::flushPairLog() {
+        log_tr log = getPairLog();
+        {
+            std::unique_lock<std::mutex> lock(logMutex_);
+            std::cerr<<log.str();
+        }
+        log.str("");
+    }
+
+    template<shared::kType K>
+    inline typename Homology<K>::k_t
+    Homology<K>::getK() const noexcept {
+        return K == 0 ? k_ : K;
+    }
+
+    template<shared::kType K>
+    inline typename Homology<K>::score_t
+    Homology<K>::getSimilarityMinVal() const noexcept {
+        return K == 0 ? similarityMinVal_ : 1.0/(K*2.0);
+    }
+
     // 2 generalized Jaccard similarity
     // all kmers must be calculated before
 
 
-    inline Homology::score_t
-    Homology::calculateSimilarity(const gene_tr gene1, const gene_tr gene2) const {
+    template<shared::kType K>
+    inline bool
+    Homology<K>::isDiscarded(const gene_tr gene1, const gene_tr gene2) const {
+        return gene1.getAlphabetLength() < gene2.getCut() || gene2.getAlphabetLength() < gene1.getCut();
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::calculateCompatibleRanges(
+        genome_t::gene_ctr rowGenes, genome_t::order_ctr rowOrder,
+        genome_t::gene_ctr colGenes, genome_t::order_ctr colOrder,
+        ranges_tr ranges
+    ) const {
+        ranges.resize(rowGenes.size());
+
+        // con le colonne ordinate per lunghezza:
+        // - colLength >= rowCut vale da first in poi
+        // - colCut <= rowLength vale fino a second (il cut cresce con la lunghezza)
+        // righe visitate per lunghezza crescente, entrambi i puntatori avanzano soltanto
+        index_t first = 0;
+        index_t second = 0;
+        for(auto row = rowOrder.begin(); row != rowOrder.end(); ++row) {
+            gene_tr rowGene = rowGenes[*row];
+
+            while(first < colOrder.size() && colGenes[colOrder[first]].getAlphabetLength() < rowGene.getCut())
+                ++first;
+            while(second < colOrder.size() && colGenes[colOrder[second]].getCut() <= rowGene.getAlphabetLength())
+                ++second;
+
+            ranges[*row] = first < second ? std::make_pair(first, second) : std::make_pair(first, first);
+        }
+    }
+
+    template<shared::kType K>
+    inline typename Homology<K>::score_t
+    Homology<K>::calculateUpperBound(const gene_tr gene1, const gene_tr gene2) const {
+        if(isDiscarded(gene1, gene2))
+            return 0;
+
+        std::size_t multiplicity1 = gene1.getKmerContainer()->getMultiplicityNumber();
+        std::size_t multiplicity2 = gene2.getKmerContainer()->getMultiplicityNumber();
+
+        // stessa divisione di calculateSimilarity con num = min, quindi il bound non e' mai minore del punteggio
+        return multiplicity1 < multiplicity2 ? 1.0*multiplicity1/multiplicity2 : 1.0*multiplicity2/multiplicity1;
+    }
+
+    template<shared::kType K>
+    inline BBHEngine
+    Homology<K>::getPairEngine(genome_t::gene_ctr rowGenes, genome_t::gene_ctr colGenes) const {
+        if(engine_ == BBHEngine::streaming)
+            return engine_;
+
+        // il denominatore di un punteggio non supera la somma delle molteplicita' dei due geni
+        multiplicity_t rowMax = 0, colMax = 0;
+        for(auto gene = rowGenes.begin(); gene != rowGenes.end(); ++gene)
+            rowMax = std::max<multiplicity_t>(rowMax, gene->getKmerContainer()->getMultiplicityNumber());
+        for(auto gene = colGenes.begin(); gene != colGenes.end(); ++gene)
+            colMax = std::max<multiplicity_t>(colMax, gene->getKmerContainer()->getMultiplicityNumber());
+        return ScoreCodec::isExact(rowMax + colMax) ? engine_ : BBHEngine::streaming;
+    }
+
+    template<shared::kType K>
+    inline std::size_t
+    Homology<K>::calculateMinIntersection(const std::size_t total, const std::size_t maxIntersection, const score_t threshold) const {
+        if(threshold <= 0)
+            return 0;
+
+        std::size_t num = static_cast<std::size_t>(std::ceil(threshold * total / (1.0 + threshold)));
+        if(num > maxIntersection + 1)
+            num = maxIntersection + 1;
+
+        // la stima in floating point viene corretta con la stessa divisione usata per il punteggio
+        while(num > 0 && 1.0*(num - 1)/(total - (num - 1)) >= threshold)
+            --num;
+        while(num <= maxIntersection && 1.0*num/(total - num) < threshold)
+            ++num;
+
+        return num;
+    }
+
+    template<shared::kType K>
+    inline typename Homology<K>::score_t
+    Homology<K>::calculateSimilarity(const gene_tr gene1, const gene_tr gene2, const score_t threshold, bool& aborted) const {
         // if(gene1.getGeneFilePosition() == 29745 && gene2.getGeneFilePosition() == 29747
         // || gene2.getGeneFilePosition() == 29745 && gene1.getGeneFilePosition() == 29747) {
         //     std::cerr<<gene1.getGeneFilePosition()<<": "<<gene1.getAlphabetLength()<<"\n"<<gene1.getAlphabet();
         //     std::cerr<<gene2.getGeneFilePosition()<<": "<<gene2.getAlphabetLength()<<"\n"<<gene2.getAlphabet();
         // }
+        aborted = false;
         return
-            (
-            gene1.getAlphabetLength() < gene2.getCut()
-            || gene2.getAlphabetLength() < gene1.getCut()
-            ) ? 
+            isDiscarded(gene1, gene2) ? 
             0
             :
             calculateSimilarity(
                 gene1.getKmersNum() < gene2.getKmersNum() ? *gene1.getKmerContainer() : *gene2.getKmerContainer(),
-                gene1.getKmersNum() < gene2.getKmersNum() ? *gene2.getKmerContainer() : *gene1.getKmerContainer()
+                gene1.getKmersNum() < gene2.getKmersNum() ? *gene2.getKmerContainer() : *gene1.getKmerContainer(),
+                threshold, aborted
         );
     }
 
 
-    inline Homology::score_t
-    Homology::calculateSimilarity(kmersContainer_tr shortestContainer, kmersContainer_tr longestContainer) const {
+    template<shared::kType K>
+    inline typename Homology<K>::score_t
+    Homology<K>::calculateSimilarity(kmersContainer_tr shortestContainer, kmersContainer_tr longestContainer, const score_t threshold, bool& aborted) const {
         
         index_t longestBiggerKey = longestContainer.getBiggerKey();
 
@@ -280,6 +1206,15 @@ namespace homology {
         multiplicity_t currentShortestMultiplicity = 0;
         multiplicity_t currentLongestMultiplicity = 0;
 
+        // molteplicita' non ancora visitate: num non puo' crescere piu' del minimo tra le due
+        multiplicity_t remainingShortest = shortestContainer.getMultiplicityNumber();
+        multiplicity_t remainingLongest = longestContainer.getMultiplicityNumber();
+        const std::size_t minNum = calculateMinIntersection(
+            remainingShortest + remainingLongest,
+            remainingShortest < remainingLongest ? remainingShortest : remainingLongest,
+            threshold
+        );
+
         auto shortestSetBegin = shortestSet.begin();
         auto longestSetBegin = longestSet.begin();
         auto shortestSetEnd = shortestSet.end();
@@ -295,11 +1230,13 @@ namespace homology {
                 break;
             }
             
-            if (shortestKey < longestKey)
+            if (shortestKey < longestKey) {
+                remainingShortest -= shortestSetBegin->second;
                 ++shortestSetBegin;
-            else if(shortestKey > longestKey)
+            } else if(shortestKey > longestKey) {
+                remainingLongest -= longestSetBegin->second;
                 ++longestSetBegin;
-            else {
+            } else {
                 
 
                 multiplicity_t currentKmerValue = shortestSetBegin->second;
@@ -310,20 +1247,28 @@ namespace homology {
 
                 currentShortestMultiplicity += currentKmerValue;
                 currentLongestMultiplicity += longestVal;
+
+                remainingShortest -= currentKmerValue;
+                remainingLongest -= longestVal;
                 
                 ++shortestSetBegin;
                 ++longestSetBegin;
             }
+
+            if(num + (remainingShortest < remainingLongest ? remainingShortest : remainingLongest) < minNum) {
+                aborted = true;
+                return 0;
+            }
         }
         
 
         return
             (
                 (
-                    ((1.0* currentShortestMultiplicity) / (shortestContainer.getAlphabetLength() - k_ +1)) < similarityMinVal_
+                    ((1.0* currentShortestMultiplicity) / (shortestContainer.getAlphabetLength() - getK() +1)) < getSimilarityMinVal()
                 ) ||
                 (
-                    ((1.0* currentLongestMultiplicity) / (longestContainer.getAlphabetLength() - k_ +1)) < similarityMinVal_
+                    ((1.0* currentLongestMultiplicity) / (longestContainer.getAlphabetLength() - getK() +1)) < getSimilarityMinVal()
                 )
             ) ? 
             0 : (
@@ -333,53 +1278,460 @@ namespace homology {
     }
 
 
+    template<shared::kType K>
+    inline typename Homology<K>::score_t
+    Homology<K>::calculateSimilarity(const denseProfile_tr rowProfile, const gene_tr rowGene, const gene_tr colGene, const score_t threshold, bool& aborted) const {
+        aborted = false;
+        if(isDiscarded(rowGene, colGene))
+            return 0;
+
+        kmersContainer_tr rowContainer = *rowGene.getKmerContainer();
+        kmersContainer_tr colContainer = *colGene.getKmerContainer();
+        kmersSet_tr colSet = colContainer.getKmerSet();
+
+        const std::size_t rowMultiplicity = rowContainer.getMultiplicityNumber();
+        const std::size_t colMultiplicity = colContainer.getMultiplicityNumber();
+
+        std::size_t num = 0;
+        // somma dei massimi sui kmer della colonna, i kmer solo della riga si aggiungono alla fine
+        std::size_t den = 0;
+
+        std::size_t currentRowMultiplicity = 0;
+        std::size_t currentColMultiplicity = 0;
+        std::size_t remainingCol = colMultiplicity;
+
+        const std::size_t minNum = calculateMinIntersection(
+            rowMultiplicity + colMultiplicity,
+            rowMultiplicity < colMultiplicity ? rowMultiplicity : colMultiplicity,
+            threshold
+        );
+
+        for(auto kmer = colSet.begin(); kmer != colSet.end(); ++kmer) {
+            std::size_t colVal = kmer->second;
+            std::size_t rowVal = rowProfile.getMultiplicity(kmer->first);
+
+            // senza salti: un kmer assente nella riga ha rowVal 0
+            num += rowVal < colVal ? rowVal : colVal;
+            den += rowVal < colVal ? colVal : rowVal;
+            currentRowMultiplicity += rowVal;
+            currentColMultiplicity += rowVal != 0 ? colVal : 0;
+            remainingCol -= colVal;
+
+            std::size_t remainingRow = rowMultiplicity - currentRowMultiplicity;
+            if(num + (remainingRow < remainingCol ? remainingRow : remainingCol) < minNum) {
+                aborted = true;
+                return 0;
+            }
+        }
+
+        return
+            (
+                ((1.0* currentRowMultiplicity) / (rowContainer.getAlphabetLength() - getK() +1)) < getSimilarityMinVal() ||
+                ((1.0* currentColMultiplicity) / (colContainer.getAlphabetLength() - getK() +1)) < getSimilarityMinVal()
+            ) ?
+            0 :
+            1.0*num/(den + (rowMultiplicity - currentRowMultiplicity));
+    }
+
+    template<shared::kType K>
+    inline typename Homology<K>::score_t
+    Homology<K>::calculateSimilarityGalloping(const gene_tr gene1, const gene_tr gene2, const score_t threshold, bool& aborted) const {
+        aborted = false;
+        if(isDiscarded(gene1, gene2))
+            return 0;
+
+        kmersContainer_tr shortestContainer = gene1.getKmersNum() < gene2.getKmersNum() ? *gene1.getKmerContainer() : *gene2.getKmerContainer();
+        kmersContainer_tr longestContainer = gene1.getKmersNum() < gene2.getKmersNum() ? *gene2.getKmerContainer() : *gene1.getKmerContainer();
+
+        kmersSet_tr shortestSet = shortestContainer.getKmerSet();
+        kmersSet_tr longestSet = longestContainer.getKmerSet();
+        const index_t longestSize = longestSet.size();
+        const index_t longestBiggerKey = longestContainer.getBiggerKey();
+
+        std::size_t num = 0;
+        std::size_t den = 0;
+        multiplicity_t currentShortestMultiplicity = 0;
+        multiplicity_t currentLongestMultiplicity = 0;
+
+        // le molteplicita' saltate della piu' lunga non vengono sommate, il bound usa solo la piu' corta
+        multiplicity_t remainingShortest = shortestContainer.getMultiplicityNumber();
+        const std::size_t minNum = calculateMinIntersection(
+            shortestContainer.getMultiplicityNumber() + longestContainer.getMultiplicityNumber(),
+            shortestContainer.getMultiplicityNumber() < longestContainer.getMultiplicityNumber() ?
+                shortestContainer.getMultiplicityNumber() : longestContainer.getMultiplicityNumber(),
+            threshold
+        );
+
+        index_t position = 0;
+        for(auto shortest = shortestSet.begin(); shortest != shortestSet.end() && position < longestSize; ++shortest) {
+            index_t key = shortest->first;
+            if(key > longestBiggerKey)
+                break;
+
+            if(longestSet[position].first < key) {
+                // longestSet[low] < key, si raddoppia il passo fino a superare key
+                index_t low = position;
+                index_t step = 1;
+                while(low + step < longestSize && longestSet[low + step].first < key) {
+                    low += step;
+                    step <<= 1;
+                }
+                index_t high = low + step < longestSize ? low + step + 1 : longestSize;
+                position = std::lower_bound(
+                    longestSet.begin() + low + 1, longestSet.begin() + high, key,
+                    [](const std::pair<index_t, multiplicity_t>& kmer, const index_t value) { return kmer.first < value; }
+                ) - longestSet.begin();
+            }
+
+            multiplicity_t shortestVal = shortest->second;
+            remainingShortest -= shortestVal;
+
+            if(position < longestSize && longestSet[position].first == key) {
+                multiplicity_t longestVal = longestSet[position].second;
+
+                num += (shortestVal < longestVal ? shortestVal : longestVal);
+                den += (shortestVal < longestVal ? longestVal : shortestVal);
+
+                currentShortestMultiplicity += shortestVal;
+                currentLongestMultiplicity += longestVal;
+                ++position;
+            }
+
+            if(num + remainingShortest < minNum) {
+                aborted = true;
+                return 0;
+            }
+        }
+
+        return
+            (
+                ((1.0* currentShortestMultiplicity) / (shortestContainer.getAlphabetLength() - getK() +1)) < getSimilarityMinVal() ||
+                ((1.0* currentLongestMultiplicity) / (longestContainer.getAlphabetLength() - getK() +1)) < getSimilarityMinVal()
+            ) ?
+            0 :
+            1.0*num/(den + ((shortestContainer.getMultiplicityNumber() - currentShortestMultiplicity) + (longestContainer.getMultiplicityNumber() - currentLongestMultiplicity)));
+    }
+
+    template<shared::kType K>
+    inline typename Homology<K>::score_t
+    Homology<K>::calculateSimilarity(const accumulator_t& accumulator, const gene_tr rowGene, const gene_tr colGene, const index_t col) const {
+        if(isDiscarded(rowGene, colGene))
+            return 0;
+
+        kmersContainer_tr rowContainer = *rowGene.getKmerContainer();
+        kmersContainer_tr colContainer = *colGene.getKmerContainer();
+
+        std::size_t currentRowMultiplicity = accumulator.getQueryShared(col);
+        std::size_t currentColMultiplicity = accumulator.getGeneShared(col);
+
+        return
+            (
+                ((1.0* currentRowMultiplicity) / (rowContainer.getAlphabetLength() - getK() +1)) < getSimilarityMinVal() ||
+                ((1.0* currentColMultiplicity) / (colContainer.getAlphabetLength() - getK() +1)) < getSimilarityMinVal()
+            ) ?
+            0 :
+            1.0*accumulator.getNum(col)/(accumulator.getDen(col) + ((rowContainer.getMultiplicityNumber() - currentRowMultiplicity) + (colContainer.getMultiplicityNumber() - currentColMultiplicity)));
+    }
+
+    template<shared::kType K>
+    inline typename Homology<K>::score_t
+    Homology<K>::calculateKernelSimilarity(
+        const SimilarityKernel kernel, const denseProfile_tr rowProfile, const accumulator_t& accumulator,
+        const gene_tr rowGene, const gene_tr colGene, const index_t col,
+        const score_t threshold, bool& aborted
+    ) const {
+        switch(kernel) {
+            case SimilarityKernel::galloping:
+                return calculateSimilarityGalloping(rowGene, colGene, threshold, aborted);
+            case SimilarityKernel::scatterGather:
+                return calculateSimilarity(rowProfile, rowGene, colGene, threshold, aborted);
+            case SimilarityKernel::invertedIndex:
+                // le intersezioni sono gia' complete, non c'e' niente da interrompere
+                aborted = false;
+                return calculateSimilarity(accumulator, rowGene, colGene, col);
+            case SimilarityKernel::merge:
+            default:
+                return calculateSimilarity(rowGene, colGene, threshold, aborted);
+        }
+    }
+
+    template<shared::kType K>
+    inline typename Homology<K>::denseProfile_tr
+    Homology<K>::getThreadProfile() {
+        static thread_local denseProfile_t profile;
+        return profile;
+    }
+
+    template<shared::kType K>
+    inline typename Homology<K>::accumulator_tr
+    Homology<K>::getThreadAccumulator() {
+        static thread_local accumulator_t accumulator;
+        return accumulator;
+    }
+
+    template<shared::kType K>
+    inline SimilarityKernel
+    Homology<K>::planSimilarityKernel(
+        genome_t::gene_ctr rowGenes, genome_t::order_ctr rowOrder,
+        genome_t::gene_ctr colGenes, genome_t::order_ctr colOrder,
+        const ranges_t& ranges, const bool triangular,
+        const index_t vocabularySize, invertedIndex_tr index
+    ) const {
+        const index_t sampleRows = 16;
+        const index_t sampleCols = 16;
+
+        // righe equidistanti nell'ordine per lunghezza, colonne equidistanti nel range compatibile
+        std::vector<std::pair<index_t, std::vector<index_t>>> sample;
+        std::size_t samplePairs = 0;
+        std::size_t compatiblePairs = 0;
+        for(auto row = rowOrder.begin(); row != rowOrder.end(); ++row)
+            compatiblePairs += ranges[*row].second - ranges[*row].first;
+        if(triangular)
+            compatiblePairs /= 2;
+
+        index_t rowsCount = rowOrder.size() < sampleRows ? rowOrder.size() : sampleRows;
+        for(index_t i = 0; i < rowsCount; ++i) {
+            index_t row = rowOrder[i * rowOrder.size() / rowsCount];
+            const range_t& range = ranges[row];
+            index_t rangeLength = range.second - range.first;
+            index_t colsCount = rangeLength < sampleCols ? rangeLength : sampleCols;
+
+            std::vector<index_t> cols;
+            for(index_t j = 0; j < colsCount; ++j) {
+                index_t col = colOrder[range.first + j * rangeLength / colsCount];
+                if(!triangular || col != row)
+                    cols.emplace_back(col);
+            }
+            if(!cols.empty()) {
+                samplePairs += cols.size();
+                sample.emplace_back(row, std::move(cols));
+            }
+        }
+
+        if(samplePairs == 0) {
+            getPairLog()<<" kernel: "<<getSimilarityKernelName(SimilarityKernel::merge);
+            return SimilarityKernel::merge;
+        }
+
+        denseProfile_tr rowProfile = getThreadProfile();
+        accumulator_tr accumulator = getThreadAccumulator();
+        stopwatch::StopWatch sw;
+        bool aborted = false;
+        // somma dei punteggi, evita che il calcolo venga eliminato
+        score_t sink = 0;
+
+        // merge e galloping: solo costo per coppia
+        double pairTime[2] = {0, 0};
+        const SimilarityKernel pairKernels[2] = {SimilarityKernel::merge, SimilarityKernel::galloping};
+        for(int kernel = 0; kernel < 2; ++kernel) {
+            sw.start();
+            for(auto row = sample.begin(); row != sample.end(); ++row)
+                for(auto col = row->second.begin(); col != row->second.end(); ++col)
+                    sink += calculateKernelSimilarity(pairKernels[kernel], rowProfile, accumulator, rowGenes[row->first], colGenes[*col], *col, 0, aborted);
+            pairTime[kernel] = sw.stop('n');
+        }
+
+        // scatter/gather: costo per riga (scatter e reset) e per coppia (gather)
+        double scatterRowTime = 0;
+        double scatterPairTime = 0;
+        std::size_t sharedKmers = 0;
+        std::size_t colKmers = 0;
+        std::size_t rowKmers = 0;
+        rowProfile.reserve(vocabularySize);
+        for(auto row = sample.begin(); row != sample.end(); ++row) {
+            gene_tr rowGene = rowGenes[row->first];
+            sw.start();
+            rowProfile.scatter(*rowGene.getKmerContainer());
+            scatterRowTime += sw.stop('n');
+
+            sw.start();
+            for(auto col = row->second.begin(); col != row->second.end(); ++col)
+                sink += calculateSimilarity(rowProfile, rowGene, colGenes[*col], 0, aborted);
+            scatterPairTime += sw.stop('n');
+
+            // densita' della sovrapposizione: kmer distinti della colonna presenti nella riga
+            rowKmers += rowGene.getKmersNum();
+            for(auto col = row->second.begin(); col != row->second.end(); ++col) {
+                kmersSet_tr colSet = colGenes[*col].getKmerContainer()->getKmerSet();
+                for(auto kmer = colSet.begin(); kmer != colSet.end(); ++kmer)
+                    sharedKmers += rowProfile.getMultiplicity(kmer->first) != 0 ? 1 : 0;
+                colKmers += colSet.size();
+            }
+
+            sw.start();
+            rowProfile.reset();
+            scatterRowTime += sw.stop('n');
+        }
+
+        // inverted index: costruzione, costo per riga (postings) e per coppia (lettura)
+        sw.start();
+        index.build(colGenes, vocabularySize);
+        double buildTime = sw.stop('n');
+        double invertedRowTime = 0;
+        double invertedPairTime = 0;
+        accumulator.reserve(colGenes.size());
+        for(auto row = sample.begin(); row != sample.end(); ++row) {
+            gene_tr rowGene = rowGenes[row->first];
+            sw.start();
+            accumulator.accumulate(*rowGene.getKmerContainer(), index);
+            invertedRowTime += sw.stop('n');
+
+            sw.start();
+            for(auto col = row->second.begin(); col != row->second.end(); ++col)
+                sink += calculateSimilarity(accumulator, rowGene, colGenes[*col], *col);
+            invertedPairTime += sw.stop('n');
+        }
+        accumulator.reset();
+
+        // stima in nanosecondi su tutte le coppie compatibili
+        const double rows = triangular ? rowOrder.size() / 2.0 : rowOrder.size();
+        const double sampledRows = sample.size();
+        double estimates[4];
+        estimates[0] = pairTime[0] / samplePairs * compatiblePairs;
+        estimates[1] = pairTime[1] / samplePairs * compatiblePairs;
+        estimates[2] = scatterRowTime / sampledRows * rows + scatterPairTime / samplePairs * compatiblePairs;
+        estimates[3] = buildTime + invertedRowTime / sampledRows * rowOrder.size() + invertedPairTime / samplePairs * compatiblePairs;
+        const SimilarityKernel kernels[4] = {
+            SimilarityKernel::merge, SimilarityKernel::galloping,
+            SimilarityKernel::scatterGather, SimilarityKernel::invertedIndex
+        };
+
+        int best = 0;
+        for(int kernel = 1; kernel < 4; ++kernel)
+            best = estimates[kernel] < estimates[best] ? kernel : best;
+
+        log_tr log = getPairLog();
+        log<<" kernel: "<<getSimilarityKernelName(kernels[best])<<" (estimated ms";
+        for(int kernel = 0; kernel < 4; ++kernel)
+            log<<(kernel == 0 ? " " : ", ")<<getSimilarityKernelName(kernels[kernel])<<": "<<std::round(estimates[kernel] / 1e5) / 10;
+        log<<"; kmers row: "<<rowKmers / sample.size()
+            <<", col: "<<colKmers / samplePairs
+            <<", overlap: "<<std::round(1000.0 * sharedKmers / (colKmers == 0 ? 1 : colKmers)) / 10<<"%"
+            <<(sink < 0 ? "!" : "")<<")";
+
+        return kernels[best];
+    }
+
     
-    void Homology::calculateBidirectionalBestHit(genome::GenomesContainer& gc, bool mode) {
+    template<shared::kType K>
+    void Homology<K>::calculateBidirectionalBestHit(genome::GenomesContainer& gc, bool mode) {
         // std::cerr<<"\npre resize";
         mins_.resize(gc.size());
         // std::cerr<<"\npost resize";
 
+        std::cerr<<"\nSimilarity kernel: "<<getSimilarityKernelName(kernel_);
+        std::cerr<<"\nEngine: "<<(K == 0 ? "generic" : "specialized")<<" k = "<<getK()<<", "<<getBBHEngineName(engine_)<<" BBH";
+
         // std::cerr<<"\nsimilarityMinVal_: "<<similarityMinVal_<<"\n";
-        if(mode) {
+
+        // i geni non cambiano piu' dopo il caricamento
+        for(auto genome = gc.getGenomes().begin(); genome != gc.getGenomes().end(); ++genome)
+            genome->calculateLengthOrder();
+
+        if(checkpointing_)
+            startCheckpoint(gc.getGenomes());
+        if(!statePath_.empty() || !pairCacheDirectory_.empty())
+            for(auto genome = gc.getGenomes().begin(); genome != gc.getGenomes().end(); ++genome)
+                hashes_.push_back(RunState::hashGenome(*genome));
+        if(!statePath_.empty())
+            startRunState(gc.getGenomes());
+        if(!pairCacheDirectory_.empty())
+            pairCache_.reset(new PairCache(pairCacheDirectory_, getK(), shared::cut));
+
+        if(!mergeFiles_.empty()) {
+            calculateMerge(gc.getGenomes());
+
+        } else if(shardCount_ > 0 || !shardDirectory_.empty()) {
+            calculateShard(gc.getGenomes());
+
+        } else if(blockTraversal_) {
+            calculateByBlocks(gc.getGenomes());
+
+        } else if(mode && (profileBudget_ > 0 || !spillDirectory_.empty())) {
+            calculateWithProfileCache(gc.getGenomes());
+
+        } else if(mode) {
             genome::GenomesContainer::genome_ctr genomes = gc.getGenomes();
+            index_t n = genomes.size();
 
             auto& pool = *pool_;
-            
-            for(auto rowGenome = genomes.begin(); rowGenome != genomes.end(); ++rowGenome) {
-                // std::cerr<<"\npre mapper";
-                
-                kmers::KmerMapper mapper;
-                
-                auto& rowRef = *rowGenome;
-                // std::cerr<<"\npre mapping";
-                rowRef.createAndCalculateAllKmers(k_, mapper);
-                // std::cerr<<"\npost mapping";
-                
-                auto colGenome = rowGenome;
-                ++colGenome;
-                
-                for(; colGenome != genomes.end(); ++colGenome){
-                    colGenome->createAndCalculateAllKmers(k_, mapper);
-                    calculateBidirectionalBestHitDifferentGenomes(*colGenome, rowRef);
-                    colGenome->deleteAllKmers(pool);
-                }
 
-                // calculateBidirectionalBestHitSameGenome(rowRef);
+            // doppio buffer: mentre una coppia viene calcolata un thread elimina i kmer dei genomi
+            // gia' confrontati e calcola quelli del prossimo genoma, il mapper e' usato solo da lui
+            std::thread stage;
+            std::exception_ptr stageError;
+            std::vector<genome_tp> retired;
+            auto startStage = [this, &pool, &stage, &stageError, &retired](genome_tp next, kmers::KmerMapper* mapper) {
+                std::vector<genome_tp> done;
+                done.swap(retired);
+                stage = std::thread(
+                    [this, &pool, &stageError, done, next, mapper] {
+                        try {
+                            for(auto genome = done.begin(); genome != done.end(); ++genome)
+                                (*genome)->deleteAllKmers(pool);
+                            if(next != nullptr)
+                                next->createAndCalculateAllKmers<K>(k_, *mapper);
+                        } catch(...) {
+                            stageError = std::current_exception();
+                        }
+                    }
+                );
+            };
+            // l'errore del thread di preparazione viene rilanciato qui
+            auto finishStage = [&stage, &stageError] {
+                if(stage.joinable())
+                    stage.join();
+                if(stageError)
+                    std::rethrow_exception(stageError);
+            };
+
+            std::unique_ptr<kmers::KmerMapper> mapper(new kmers::KmerMapper());
+            if(n > 0)
+                genomes.front().createAndCalculateAllKmers<K>(k_, *mapper);
+
+            // un thread ancora attivo non puo' essere distrutto: atteso anche in caso di errore
+            try {
+                for(index_t row = 0; row < n; ++row) {
+                    auto& rowRef = genomes[row];
+
+                    // i kmer non servono alle coppie del checkpoint e dello stato precedente
+                    std::vector<genome_tp> cols;
+                    for(index_t col = row + 1; col < n; ++col) {
+                        if(isReused(rowRef, genomes[col]))
+                            calculateBidirectionalBestHitDifferentGenomes(genomes[col], rowRef);
+                        else
+                            cols.push_back(&genomes[col]);
+                    }
+
+                    if(!cols.empty())
+                        startStage(cols.front(), mapper.get());
+                    for(index_t i = 0; i < cols.size(); ++i) {
+                        finishStage();
+                        if(i + 1 < cols.size())
+                            startStage(cols[i + 1], mapper.get());
+                        calculateBidirectionalBestHitDifferentGenomes(*cols[i], rowRef);
+                        retired.push_back(cols[i]);
+                    }
 
-                rowRef.deleteAllKmers(pool);
-            }
-            // std::cerr<<"\ncomputing mins";
-            mins_.computeMins(pool);
-            // std::cerr<<"\npost computing mins";
-            mins_.print();
+                    // le coppie con i genomi precedenti sono state calcolate nelle righe prima: il minimo e'
+                    // definitivo, la riga successiva viene preparata durante il confronto con se stesso
+                    mins_.computeMin(rowRef.getId());
+                    std::unique_ptr<kmers::KmerMapper> nextMapper(new kmers::KmerMapper());
+                    startStage(row + 1 < n ? &genomes[row + 1] : nullptr, nextMapper.get());
+                    calculateBidirectionalBestHitSameGenome(rowRef);
+                    finishStage();
 
-            for(auto rowGenome = genomes.begin(); rowGenome != genomes.end(); ++rowGenome) {
-                kmers::KmerMapper mapper;
-                auto& rowRef = *rowGenome;
-                rowRef.createAndCalculateAllKmers(k_, mapper);
-                calculateBidirectionalBestHitSameGenome(rowRef);
-                rowRef.deleteAllKmers(pool);
+                    retired.push_back(&rowRef);
+                    mapper.swap(nextMapper);
+                }
+            } catch(...) {
+                if(stage.joinable())
+                    stage.join();
+                throw;
             }
+            for(auto genome = retired.begin(); genome != retired.end(); ++genome)
+                (*genome)->deleteAllKmers(pool);
+            mins_.print();
 
         } else {
 
@@ -389,239 +1741,913 @@ namespace homology {
             {
                 kmers::KmerMapper mapper;
                 for(auto genome = genomes.begin(); genome != genomes.end(); ++genome)
-                    genome->createAndCalculateAllKmers(k_, mapper);
+                    genome->createAndCalculateAllKmers<K>(k_, mapper);
             }
 
             auto& pool = *pool_;
             
             // Compare each genome with every other genome to find BBH
+            // coppie indipendenti: piu' coppie insieme, in ordine di costo decrescente (geni riga * geni colonna)
+            scheduler_t pairs;
+
+            // il minimo di un genoma dipende solo dalle sue coppie: appena sono tutte calcolate
+            // il confronto del genoma con se stesso entra in coda, senza attendere gli altri genomi
+            std::vector<index_t> pendingPairs(genomes.size(), genomes.size() - 1);
+            std::mutex pendingMutex;
+            auto addSameGenome = [this, &pairs, &pool](genome_tp genome) {
+                mins_.computeMin(genome->getId());
+                pairs.add(
+                    genome->size() * genome->size() / 2,
+                    [this, genome, &pool] {
+                        calculateBidirectionalBestHitSameGenome(*genome);
+                        genome->deleteAllKmers(pool);
+                    }
+                );
+            };
+
+            index_t jobsNumber = genomes.size();
             for(auto rowGenome = genomes.begin(); rowGenome != genomes.end(); ++rowGenome) {
-                auto& rowRef = *rowGenome;
+                genome_tp rowPtr = &*rowGenome;
                 
                 auto colGenome = rowGenome;
                 ++colGenome;
                 
                 for(; colGenome != genomes.end(); ++colGenome) {
-                    calculateBidirectionalBestHitDifferentGenomes(*colGenome, rowRef);
+                    genome_tp colPtr = &*colGenome;
+                    pairs.add(
+                        rowPtr->size() * colPtr->size(),
+                        [this, colPtr, rowPtr, &pendingPairs, &pendingMutex, &addSameGenome] {
+                            calculateBidirectionalBestHitDifferentGenomes(*colPtr, *rowPtr);
+
+                            bool rowReady, colReady;
+                            {
+                                std::unique_lock<std::mutex> lock(pendingMutex);
+                                rowReady = --pendingPairs[rowPtr->getId()] == 0;
+                                colReady = --pendingPairs[colPtr->getId()] == 0;
+                            }
+                            if(rowReady)
+                                addSameGenome(rowPtr);
+                            if(colReady)
+                                addSameGenome(colPtr);
+                        }
+                    );
+                    ++jobsNumber;
                 }
-                
-
             }
-            // std::cerr<<"\npre computing mins";
 
-            mins_.computeMins(pool);
-            // std::cerr<<"\npost computing mins";
+            // un solo genoma non ha coppie
+            if(genomes.size() == 1)
+                addSameGenome(&genomes.front());
+
+            pairs.run(getConcurrentPairs(jobsNumber));
 
             mins_.print();
-            for(auto rowGenome = genomes.begin(); rowGenome != genomes.end(); ++rowGenome) {
-                auto& rowRef = *rowGenome;
-                calculateBidirectionalBestHitSameGenome(rowRef);
-                rowRef.deleteAllKmers(pool);
-            }
             
         }
-    
+
+        if(checkpoint_)
+            checkpoint_->save(outStream_);
+        if(runState_)
+            runState_->commit();
+        if(pairCache_) {
+            std::cerr<<"\nPair cache (";
+            pairCache_->print(std::cerr);
+            std::cerr<<")";
+        }
+
+        std::cerr<<"\nTotal pairs (";
+        totalPruning_.print(std::cerr);
+        std::cerr<<")";
         
 
     }
 
+    template<shared::kType K>
+    inline void
+    Homology<K>::calculateWithProfileCache(genome::GenomesContainer::genome_ctr genomes) {
+        std::unique_ptr<genome::ProfileStore> store;
+        if(!spillDirectory_.empty())
+            store.reset(new genome::ProfileStore(spillDirectory_, genomes.size()));
+        genome::ProfileCache cache(genomes.size(), profileBudget_, *pool_, store.get());
+        index_t n = genomes.size();
+
+        for(index_t row = 0; row < n; ++row) {
+            genome_tr rowRef = genomes[row];
+            cache.acquire<K>(rowRef, k_);
+
+            // righe pari dall'ultima colonna, dispari dalla prima
+            for(index_t i = row + 1; i < n; ++i) {
+                genome_tr colRef = genomes[row % 2 == 0 ? n - i + row : i];
+                if(isReused(rowRef, colRef)) {
+                    calculateBidirectionalBestHitDifferentGenomes(colRef, rowRef);
+                    continue;
+                }
+                cache.acquire<K>(colRef, k_);
+                calculateBidirectionalBestHitDifferentGenomes(colRef, rowRef);
+                cache.release(colRef);
+            }
+
+            // le coppie con i genomi precedenti sono state calcolate nelle righe prima
+            mins_.computeMin(rowRef.getId());
+            calculateBidirectionalBestHitSameGenome(rowRef);
+
+            cache.release(rowRef);
+            cache.evict(rowRef);
+        }
+        mins_.print();
+
+        std::cerr<<"\nProfile cache (";
+        cache.print(std::cerr);
+        if(store) {
+            std::cerr<<", ";
+            store->print(std::cerr);
+        }
+        std::cerr<<")";
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::calculateByBlocks(genome::GenomesContainer::genome_ctr genomes) {
+        std::size_t budget = profileBudget_ > 0 ? profileBudget_ : utilities::MemoryInfo::getAvailableMemory() / 2;
+        // budget 0: restano in memoria solo i genomi acquisiti, cioe' il blocco e il genoma confrontato
+        std::unique_ptr<genome::ProfileStore> store;
+        if(!spillDirectory_.empty())
+            store.reset(new genome::ProfileStore(spillDirectory_, genomes.size()));
+        genome::ProfileCache cache(genomes.size(), 0, *pool_, store.get());
+        scheduler_t pairs;
+        index_t n = genomes.size();
+        index_t blocks = 0, largestBlock = 0;
+        std::size_t largestGenome = 0;
+
+        for(index_t first = 0; first < n; ) {
+            index_t last = first;
+            while(
+                last < n && (
+                    blockGenomes_ > 0 ?
+                    last - first < blockGenomes_ :
+                    last == first || cache.getUsedMemory() + 2 * largestGenome <= budget
+                )
+            ) {
+                cache.acquire<K>(genomes[last], k_);
+                std::size_t bytes = genomes[last].getKmersMemoryUsage();
+                largestGenome = bytes > largestGenome ? bytes : largestGenome;
+                ++last;
+            }
+            ++blocks;
+            largestBlock = last - first > largestBlock ? last - first : largestBlock;
+
+            // coppie interne al blocco
+            index_t jobsNumber = 0;
+            for(index_t row = first; row < last; ++row) {
+                for(index_t col = row + 1; col < last; ++col) {
+                    genome_tp rowPtr = &genomes[row];
+                    genome_tp colPtr = &genomes[col];
+                    pairs.add(
+                        rowPtr->size() * colPtr->size(),
+                        [this, colPtr, rowPtr] {
+                            calculateBidirectionalBestHitDifferentGenomes(*colPtr, *rowPtr);
+                        }
+                    );
+                    ++jobsNumber;
+                }
+            }
+            pairs.run(getConcurrentPairs(jobsNumber));
+
+            // ogni genoma seguente viene caricato una volta e confrontato con tutto il blocco
+            for(index_t col = last; col < n; ++col) {
+                genome_tp colPtr = &genomes[col];
+                cache.acquire<K>(*colPtr, k_);
+                for(index_t row = first; row < last; ++row) {
+                    genome_tp rowPtr = &genomes[row];
+                    pairs.add(
+                        rowPtr->size() * colPtr->size(),
+                        [this, colPtr, rowPtr] {
+                            calculateBidirectionalBestHitDifferentGenomes(*colPtr, *rowPtr);
+                        }
+                    );
+                }
+                pairs.run(getConcurrentPairs(last - first));
+                cache.release(*colPtr);
+            }
+
+            // le coppie dei genomi del blocco sono tutte calcolate: i minimi sono definitivi
+            for(index_t row = first; row < last; ++row) {
+                genome_tp rowPtr = &genomes[row];
+                mins_.computeMin(rowPtr->getId());
+                pairs.add(
+                    rowPtr->size() * rowPtr->size() / 2,
+                    [this, rowPtr] {
+                        calculateBidirectionalBestHitSameGenome(*rowPtr);
+                    }
+                );
+            }
+            pairs.run(getConcurrentPairs(last - first));
+
+            for(index_t row = first; row < last; ++row) {
+                cache.release(genomes[row]);
+                cache.evict(genomes[row]);
+            }
+
+            first = last;
+        }
+        mins_.print();
+
+        std::cerr<<"\nBlocks: "<<blocks<<" (largest: "<<largestBlock<<" genomes, budget: "<<budget / (1024 * 1024)<<" MiB, ";
+        cache.print(std::cerr);
+        if(store) {
+            std::cerr<<", ";
+            store->print(std::cerr);
+        }
+        std::cerr<<")";
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::calculateShard(genome::GenomesContainer::genome_ctr genomes) {
+        std::vector<index_t> genes;
+        for(auto genome = genomes.begin(); genome != genomes.end(); ++genome)
+            genes.push_back(genome->size());
+        std::unique_ptr<Shard> shard(
+            shardCount_ > 0 ? new Shard(genes, shardIndex_, shardCount_) : new Shard(genes, shardDirectory_)
+        );
+
+        std::size_t budget = profileBudget_ > 0 ? profileBudget_ : utilities::MemoryInfo::getAvailableMemory() / 2;
+        std::unique_ptr<genome::ProfileStore> store;
+        if(!spillDirectory_.empty())
+            store.reset(new genome::ProfileStore(spillDirectory_, genomes.size()));
+        genome::ProfileCache cache(genomes.size(), budget, *pool_, store.get());
+        scheduler_t pairs;
+        const Shard::pairs_t& shardPairs = shard->getPairs();
+        index_t claimed = 0, computed = 0;
+
+        for(index_t batch = 0; batch < shard->getBatchesNumber(); ++batch) {
+            if(!shard->claim(batch))
+                continue;
+            ++claimed;
+
+            // i genomi del lotto restano in memoria fino alla fine del lotto
+            Shard::batch_t range = shard->getBatch(batch);
+            std::vector<genome_tp> acquired;
+            for(index_t i = range.first; i < range.second; ++i) {
+                genome_tp rowPtr = &genomes[shardPairs[i].row];
+                genome_tp colPtr = &genomes[shardPairs[i].col];
+                if(!isReused(*rowPtr, *colPtr)) {
+                    cache.acquire<K>(*rowPtr, k_);
+                    cache.acquire<K>(*colPtr, k_);
+                    acquired.push_back(rowPtr);
+                    acquired.push_back(colPtr);
+                }
+                pairs.add(
+                    shardPairs[i].cost,
+                    [this, colPtr, rowPtr] {
+                        calculateBidirectionalBestHitDifferentGenomes(*colPtr, *rowPtr);
+                    }
+                );
+            }
+            pairs.run(getConcurrentPairs(range.second - range.first));
+            computed += range.second - range.first;
+
+            for(auto genome = acquired.begin(); genome != acquired.end(); ++genome)
+                cache.release(**genome);
+        }
+
+        shard->saveMins(
+            fw->getFileName() + ".min",
+            [this](const index_t row, const index_t col) {
+                return mins_.getVal(row, col);
+            }
+        );
+
+        std::cerr<<"\nShard: "<<computed<<" pairs in "<<claimed<<" of "<<shard->getBatchesNumber()<<" batches (";
+        cache.print(std::cerr);
+        if(store) {
+            std::cerr<<", ";
+            store->print(std::cerr);
+        }
+        std::cerr<<")";
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::calculateMerge(genome::GenomesContainer::genome_ctr genomes) {
+        index_t n = genomes.size();
+        std::vector<bool> merged(n * n, false);
+        std::size_t pairs = 0;
+
+        for(auto file = mergeFiles_.begin(); file != mergeFiles_.end(); ++file) {
+            Shard::loadMins(
+                *file + ".min", n,
+                [this, &merged, &pairs, &file, n](const index_t row, const index_t col, const score_t min) {
+                    if(merged[row * n + col])
+                        throw std::runtime_error("pair " + std::to_string(row) + " " + std::to_string(col) + " in more shards (" + *file + ")");
+                    merged[row * n + col] = true;
+                    ++pairs;
+                    mins_.setVal(row, col, min);
+                }
+            );
+
+            std::ifstream lines(*file);
+            if(!lines.is_open())
+                throw std::runtime_error("missing shard output " + *file);
+            outStream_<<lines.rdbuf();
+        }
+        if(pairs != n * (n - 1) / 2)
+            throw std::runtime_error("merged " + std::to_string(pairs) + " pairs of " + std::to_string(n * (n - 1) / 2) + ": shards missing");
+        outStream_.flush();
+
+        // i minimi sono definitivi: ogni genoma con se stesso
+        for(auto genome = genomes.begin(); genome != genomes.end(); ++genome) {
+            mins_.computeMin(genome->getId());
+            kmers::KmerMapper mapper;
+            genome->createAndCalculateAllKmers<K>(k_, mapper);
+            calculateBidirectionalBestHitSameGenome(*genome);
+            genome->deleteAllKmers(*pool_);
+        }
+        mins_.print();
+
+        std::cerr<<"\nMerged shards: "<<mergeFiles_.size()<<" ("<<pairs<<" pairs)";
+    }
+
     
     // colGenome, rowGenome
+    template<shared::kType K>
     inline void
-    Homology::calculateBidirectionalBestHitDifferentGenomes(
+    Homology<K>::calculateBidirectionalBestHitDifferentGenomes(
         genome_tr colGenome, genome_tr rowGenome
     ) {
         // std::cerr<<"\ncomparing different";
-        std::cerr<<"\nComparing different genomes <col, row> "<<colGenome.getId()<<" - "<<rowGenome.getId();
+        getPairLog()<<"\nComparing different genomes <col, row> "<<colGenome.getId()<<" - "<<rowGenome.getId();
+
+        // calcolata prima dell'interruzione: il minimo e' stato ripristinato dal checkpoint
+        if(isCompleted(rowGenome.getId(), colGenome.getId())) {
+            getPairLog()<<" (checkpoint)";
+            flushPairLog();
+            return;
+        }
 
         // genes in genome1 rapresents the width of the matrix (cols), genes in genome2 rapresents the height(rows)
         genome_t::gene_ctr colGenes = colGenome.getGenes();
         genome_t::gene_ctr rowGenes = rowGenome.getGenes();
 
 
-        BBHcandidatesContainer_t bestRows(rowGenes.size(), colGenes.size());
+        // contenitori riusati dalle coppie precedenti, azzerati dai getter
+        pairWorkspace_tp workspace = workspaces_.acquire();
+        edges_tr edges = workspace->getEdges();
+        std::string& output = workspace->getOutput();
+        score_t minBBH;
+
+        // coppia dello stato precedente o della cache, eventualmente con i genomi scambiati: i BBH sono simmetrici
+        bool transposed;
+        const char* reused = nullptr;
+        if(runState_ && runState_->findPair(hashes_[rowGenome.getId()], hashes_[colGenome.getId()], minBBH, workspace->getPreviousEdges(), transposed))
+            reused = "previous run";
+        else if(pairCache_ && pairCache_->find(hashes_[rowGenome.getId()], hashes_[colGenome.getId()], rowGenes.size(), colGenes.size(), minBBH, workspace->getPreviousEdges(), transposed))
+            reused = "pair cache";
+        if(reused != nullptr) {
+            edges.add(workspace->getPreviousEdges(), transposed);
+            mins_.setVal(rowGenome.getId(), colGenome.getId(), minBBH);
+            writePair(rowGenome, colGenome, minBBH, edges, output);
+            workspaces_.release(workspace);
+
+            getPairLog()<<" ("<<reused<<")";
+            flushPairLog();
+            return;
+        }
 
-        ScoresContainer scores(rowGenes.size(), colGenes.size());
+        BBHcandidatesContainer_tr bestRows = workspace->getBestRows(rowGenes.size());
+        bestScores_tr bestCols = workspace->getBestCols(colGenes.size());
+        bestScores_tr bestRowScores = workspace->getBestRowScores(rowGenes.size());
+        rowsMutexes_tr rowsMutexes = workspace->getRowsMutexes();
+        invertedIndex_tr invertedIndex = workspace->getInvertedIndex();
+        pruningCounters_t counters;
+        BBHEngine engine = getPairEngine(rowGenes, colGenes);
+
+        if(engine == BBHEngine::matrix) {
+            // i tile scrivono blocchi interi, checkForBBH legge colonne: blocchi memorizzati per colonna
+            ScoresContainer& scores = workspace->getScores(rowGenes.size(), colGenes.size());
+
+            // per la crezione della comparazione modificare qui il valore passatto usando "startCol"
+            calculateRow(
+                rowGenes, rowGenome.getLengthOrder(),
+                colGenes, colGenome.getLengthOrder(),
+                bestRows, &scores, nullptr, nullptr, nullptr,
+                bestRowScores, bestCols, rowsMutexes, invertedIndex, counters
+            );
 
-        // per la crezione della comparazione modificare qui il valore passatto usando "startCol"
-        calculateRow(
-            rowGenes, colGenes,
-            bestRows, scores
-        );
+            minBBH = checkForBBH(
+                colGenes, rowGenes,
+                bestRows,
+                scores,
+                edges
+            );
+        } else if(engine == BBHEngine::sparse) {
+            SparseScoresContainer& scores = workspace->getSparseScores(rowGenes.size(), colGenes.size());
+
+            calculateRow(
+                rowGenes, rowGenome.getLengthOrder(),
+                colGenes, colGenome.getLengthOrder(),
+                bestRows, nullptr, nullptr, &scores, nullptr,
+                bestRowScores, bestCols, rowsMutexes, invertedIndex, counters
+            );
+            scores.compress();
 
-        score_t minBBH = checkForBBH(
-            colGenes, rowGenes,
-            bestRows,
-            scores
-        );
+            minBBH = checkForBBH(
+                colGenes, rowGenes,
+                bestRows,
+                scores,
+                edges
+            );
+        } else {
+            // solo migliori e pari merito di righe e colonne, lineare nel numero di geni
+            columnHits_tr columnHits = workspace->getColumnHits();
+
+            calculateRow(
+                rowGenes, rowGenome.getLengthOrder(),
+                colGenes, colGenome.getLengthOrder(),
+                bestRows, nullptr, nullptr, nullptr, &columnHits,
+                bestRowScores, bestCols, rowsMutexes, invertedIndex, counters
+            );
+
+            minBBH = checkForBBH(
+                bestRows,
+                bestCols,
+                columnHits,
+                edges
+            );
+        }
 
         mins_.setVal(rowGenome.getId(), colGenome.getId(), minBBH);
+        writePair(rowGenome, colGenome, minBBH, edges, output);
+        if(pairCache_)
+            pairCache_->store(hashes_[rowGenome.getId()], hashes_[colGenome.getId()], rowGenes.size(), colGenes.size(), minBBH, edges.getEdges());
+
+        workspaces_.release(workspace);
+
+        log_tr log = getPairLog();
+        log<<" (";
+        counters.print(log);
+        log<<")";
+        flushPairLog();
+        totalPruning_.add(counters);
     }
 
     
 
     // inline Homology::containerTypePointer
+    template<shared::kType K>
     inline void
-    Homology::calculateBidirectionalBestHitSameGenome(
+    Homology<K>::calculateBidirectionalBestHitSameGenome(
         genome_tr genome
     ) {
-        std::cerr<<"\nComparing same genomes "<<genome.getId()<<" - "<<genome.getId();
+        getPairLog()<<"\nComparing same genomes "<<genome.getId()<<" - "<<genome.getId();
+
+        if(isCompleted(genome.getId(), genome.getId())) {
+            getPairLog()<<" (checkpoint)";
+            flushPairLog();
+            return;
+        }
         // std::cerr<<"\ncomparing same";
         genome_t::gene_ctr genes = genome.getGenes();
         // genome_t::gene_ctr rowGenes = genome.getGenes();
 
-        BBHcandidatesContainer_t bestRows(genome.size(), genome.size());
-        ScoresContainer scores(genome.size(), genome.size());
+        pairWorkspace_tp workspace = workspaces_.acquire();
+        edges_tr edges = workspace->getEdges();
+        std::string& output = workspace->getOutput();
+        score_t min = mins_.getMin(genome.getId());
 
-        calculateRowSame(
-            genome.getId(),
-            genes,
-            bestRows, scores
-        );
+        // lo stato precedente vale solo se il genoma ha ancora lo stesso minimo
+        if(runState_ && runState_->findGenome(hashes_[genome.getId()], min, workspace->getPreviousEdges())) {
+            edges.add(workspace->getPreviousEdges(), false);
+            writePair(genome, genome, min, edges, output);
+            workspaces_.release(workspace);
 
-        checkForBBHSame(
-            genes,
-            bestRows,
-            scores
-        );
+            getPairLog()<<" (previous run)";
+            flushPairLog();
+            return;
+        }
+
+        BBHcandidatesContainer_tr bestRows = workspace->getBestRows(genome.size());
+        bestScores_tr bestCols = workspace->getBestCols(genome.size());
+        bestScores_tr bestRowScores = workspace->getBestRowScores(genome.size());
+        rowsMutexes_tr rowsMutexes = workspace->getRowsMutexes();
+        invertedIndex_tr invertedIndex = workspace->getInvertedIndex();
+        pruningCounters_t counters;
+        BBHEngine engine = getPairEngine(genes, genes);
+
+        if(engine == BBHEngine::matrix) {
+            // solo le coppie riga < colonna: meta' della matrice
+            TriangularScoresContainer& scores = workspace->getTriangularScores(genome.size());
+
+            calculateRowSame(
+                genome.getId(),
+                genes, genome.getLengthOrder(),
+                bestRows, nullptr, &scores, nullptr, nullptr,
+                bestRowScores, bestCols, rowsMutexes, invertedIndex, counters
+            );
+
+            checkForBBHSame(
+                genes,
+                bestRows,
+                scores,
+                edges
+            );
+        } else if(engine == BBHEngine::sparse) {
+            SparseScoresContainer& scores = workspace->getSparseScores(genome.size(), genome.size());
+
+            calculateRowSame(
+                genome.getId(),
+                genes, genome.getLengthOrder(),
+                bestRows, nullptr, nullptr, &scores, nullptr,
+                bestRowScores, bestCols, rowsMutexes, invertedIndex, counters
+            );
+            scores.compress();
+
+            checkForBBH(
+                genes, genes,
+                bestRows,
+                scores,
+                edges
+            );
+        } else {
+            // righe sulle colonne successive, colonne sulle righe precedenti: come checkForBBHSame
+            columnHits_tr columnHits = workspace->getColumnHits();
+
+            calculateRowSame(
+                genome.getId(),
+                genes, genome.getLengthOrder(),
+                bestRows, nullptr, nullptr, nullptr, &columnHits,
+                bestRowScores, bestCols, rowsMutexes, invertedIndex, counters
+            );
+
+            checkForBBH(
+                bestRows,
+                bestCols,
+                columnHits,
+                edges
+            );
+        }
+
+        writePair(genome, genome, min, edges, output);
+
+        workspaces_.release(workspace);
+
+        log_tr log = getPairLog();
+        log<<" (";
+        counters.print(log);
+        log<<")";
+        flushPairLog();
+        totalPruning_.add(counters);
     }
     
 
+    template<shared::kType K>
     inline void
-    Homology::calculateRowSame(
+    Homology<K>::calculateRowSame(
         index_t genomeId,
-        genome_t::gene_ctr genes,
-        BBHcandidatesContainer_tr bestRows, ScoresContainer& scores
+        genome_t::gene_ctr genes, genome_t::order_ctr order,
+        BBHcandidatesContainer_tr bestRows, ScoresContainer* scores, TriangularScoresContainer* triangularScores, SparseScoresContainer* sparseScores, columnHits_tp columnHits,
+        bestScores_tr bestRowScores, bestScores_tr bestCols, rowsMutexes_tr rowsMutexes, invertedIndex_tr index, pruningCounters_tr counters
     ) const {
-        thread_ptr poolRef = *pool_; 
-        score_t minScore = mins_.getMin(genomeId);
-
-        for(index_t row = 0; row < genes.size(); ++row){
-            poolRef.execute(
-                [row, &scores, this, &genes, &bestRows, minScore] {
-                    for(index_t col = row+1; col < genes.size(); ++col) {
-                        const auto& g = genes[row];
-                        score_t currentScore = calculateSimilarity(g, genes[col]);
-                        if(currentScore >= minScore) {
-                            scores.setScoreAt(row, col, currentScore);
-                            bestRows.addCandidate(row, currentScore, col);
-                        }
-                        // scores.setScoreAt(row, col, currentScore);
-                        // bestRows.addCandidate(row, currentScore, col);
-                    }
-                }
-            );
+        calculateTiles(
+            genes, order, genes, order,
+            mins_.getMin(genomeId), true,
+            bestRows, scores, triangularScores, sparseScores, columnHits,
+            bestRowScores, bestCols, rowsMutexes, index, counters
+        );
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::calculateRow(
+        genome_t::gene_ctr rowGenes, genome_t::order_ctr rowOrder,
+        genome_t::gene_ctr colGenes, genome_t::order_ctr colOrder,
+        BBHcandidatesContainer_tr bestRows, ScoresContainer* scores, TriangularScoresContainer* triangularScores, SparseScoresContainer* sparseScores, columnHits_tp columnHits,
+        bestScores_tr bestRowScores, bestScores_tr bestCols, rowsMutexes_tr rowsMutexes, invertedIndex_tr index, pruningCounters_tr counters) const {
+        
+        calculateTiles(
+            rowGenes, rowOrder, colGenes, colOrder,
+            0, false,
+            bestRows, scores, triangularScores, sparseScores, columnHits,
+            bestRowScores, bestCols, rowsMutexes, index, counters
+        );
+    }
+
+    template<shared::kType K>
+    inline typename Homology<K>::range_t
+    Homology<K>::calculateTileSize(genome_t::gene_ctr rowGenes, genome_t::gene_ctr colGenes) const {
+        if(!autoTileSize_) {
+            if(tileSize_ == 0)
+                return std::make_pair(1, colGenes.size());
+            return std::make_pair(tileSize_, tileSize_);
         }
-        // poolRef.waitTasks();
 
-        while(!poolRef.tasksCompleted()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        // byte medi del profilo di un gene (coppie <kmer, molteplicita'>)
+        std::size_t kmers = 0;
+        for(auto gene = rowGenes.begin(); gene != rowGenes.end(); ++gene)
+            kmers += gene->getKmersNum();
+        for(auto gene = colGenes.begin(); gene != colGenes.end(); ++gene)
+            kmers += gene->getKmersNum();
+        std::size_t genes = rowGenes.size() + colGenes.size();
+        std::size_t profileBytes = sizeof(kmersContainer_t) + sizeof(std::pair<index_t, multiplicity_t>) * (genes == 0 ? 1 : kmers / genes + 1);
+
+        // i profili delle righe e delle colonne di un tile devono stare insieme in meta' della L2
+        index_t side = utilities::CacheInfo::getL2Size() / 2 / (2 * profileBytes);
+        if(side < 8)
+            side = 8;
+
+        // abbastanza tile per tenere occupati tutti i thread
+        index_t minTiles = 4 * pool_->getTotalThread();
+        while(side > 8 && ((rowGenes.size() + side - 1) / side) * ((colGenes.size() + side - 1) / side) < minTiles)
+            side /= 2;
+
+        return std::make_pair(side, side);
+    }
+
+    template<shared::kType K>
+    inline typename Homology<K>::index_t
+    Homology<K>::calculateVocabularySize(genome_t::gene_ctr rowGenes, genome_t::gene_ctr colGenes) const {
+        index_t biggerKey = 0;
+        for(auto gene = rowGenes.begin(); gene != rowGenes.end(); ++gene)
+            biggerKey = gene->getKmerContainer()->getBiggerKey() > biggerKey ? gene->getKmerContainer()->getBiggerKey() : biggerKey;
+        for(auto gene = colGenes.begin(); gene != colGenes.end(); ++gene)
+            biggerKey = gene->getKmerContainer()->getBiggerKey() > biggerKey ? gene->getKmerContainer()->getBiggerKey() : biggerKey;
+        return biggerKey + 1;
+    }
+
+    template<shared::kType K>
+    inline void
+    Homology<K>::calculateTiles(
+        genome_t::gene_ctr rowGenes, genome_t::order_ctr rowOrder,
+        genome_t::gene_ctr colGenes, genome_t::order_ctr colOrder,
+        const score_t minScore, const bool triangular,
+        BBHcandidatesContainer_tr bestRows, ScoresContainer* scores, TriangularScoresContainer* triangularScores, SparseScoresContainer* sparseScores, columnHits_tp columnHits,
+        bestScores_tr bestRowScores, bestScores_tr bestCols, rowsMutexes_tr rowsMutexes, invertedIndex_tr index, pruningCounters_tr counters
+    ) const {
+        taskGroup_t group(*pool_);
+
+        ranges_t ranges;
+        calculateCompatibleRanges(rowGenes, rowOrder, colGenes, colOrder, ranges);
+
+        index_t vocabularySize = calculateVocabularySize(rowGenes, colGenes);
+        SimilarityKernel kernel = kernel_;
+        if(kernel == SimilarityKernel::automatic)
+            kernel = planSimilarityKernel(rowGenes, rowOrder, colGenes, colOrder, ranges, triangular, vocabularySize, index);
+        if(kernel == SimilarityKernel::invertedIndex && !index.isBuilt())
+            index.build(colGenes, vocabularySize);
+
+        range_t tileSize = calculateTileSize(rowGenes, colGenes);
+        // le postings di una riga coprono tutte le colonne, un tile prende tutta la larghezza
+        if(kernel == SimilarityKernel::invertedIndex)
+            tileSize.second = colGenes.size();
+        if(tileSize.second == 0)
+            tileSize.second = 1;
+        index_t rowBlocks = (rowOrder.size() + tileSize.first - 1) / tileSize.first;
+        index_t colBlocks = (colOrder.size() + tileSize.second - 1) / tileSize.second;
+
+        // i mutex non si spostano: se servono piu' blocchi si crea un nuovo vettore
+        if(rowsMutexes.size() < rowBlocks)
+            rowsMutexes_t(rowBlocks).swap(rowsMutexes);
+        if(columnHits != nullptr)
+            columnHits->resize(rowBlocks * colBlocks);
+        pruningCounters_t tilesCounters;
+
+        for(index_t block = 0; block < rowBlocks; ++block) {
+            range_t rowPositions(block * tileSize.first, std::min((block + 1) * tileSize.first, rowOrder.size()));
+
+            // le righe sono ordinate per lunghezza: la banda compatibile del blocco va
+            // dall'inizio del range della prima riga alla fine del range dell'ultima
+            index_t bandFirst = ranges[rowOrder[rowPositions.first]].first;
+            index_t bandSecond = ranges[rowOrder[rowPositions.second - 1]].second;
+
+            for(index_t colFirst = bandFirst - bandFirst % tileSize.second; colFirst < bandSecond; colFirst += tileSize.second) {
+                range_t colPositions(colFirst, std::min(colFirst + tileSize.second, colOrder.size()));
+                std::mutex& rowsMutex = rowsMutexes[block];
+                index_t tileSlot = block * colBlocks + colFirst / tileSize.second;
+
+                group.execute(
+                    [this, &rowGenes, &rowOrder, rowPositions, &colGenes, &colOrder, colPositions,
+                    &ranges, vocabularySize, kernel, &index, minScore, triangular, &bestRows, scores, triangularScores, sparseScores, columnHits, &bestRowScores, &bestCols, &rowsMutex, tileSlot, &tilesCounters] {
+                        calculateTile(
+                            rowGenes, rowOrder, rowPositions,
+                            colGenes, colOrder, colPositions,
+                            ranges, vocabularySize,
+                            kernel, index,
+                            minScore, triangular,
+                            bestRows, scores, triangularScores, sparseScores, columnHits,
+                            bestRowScores, bestCols,
+                            rowsMutex, tileSlot, tilesCounters
+                        );
+                    }
+                );
+            }
         }
+
+        group.wait();
+
+        // tutte le coppie non visitate da un tile sono fuori dal range del cut
+        std::size_t pairs = triangular ?
+            rowGenes.size() * (rowGenes.size() - (rowGenes.size() > 0 ? 1 : 0)) / 2 :
+            rowGenes.size() * colGenes.size();
+        std::size_t visited = tilesCounters.getPruned() + tilesCounters.getAborted() + tilesCounters.getComputed();
+        counters.add(pairs - visited, tilesCounters.getPruned(), tilesCounters.getAborted(), tilesCounters.getComputed());
     }
 
+    template<shared::kType K>
     inline void
-    Homology::calculateRow(
-        genome_t::gene_ctr rowGenes, genome_t::gene_ctr colGenes,
-        BBHcandidatesContainer_tr bestRows, ScoresContainer& scores) const {
-        
-        thread_ptr poolRef = *pool_;
-
-        for(index_t row = 0; row < rowGenes.size(); ++row){
-            // gene_tr rowGene = rowGenes.at(row);
-            poolRef.execute(
-                [row, &scores, this, &colGenes, &bestRows, &rowGenes] {
-                    gene_tr rowGene = rowGenes[row];
-                    for(index_t col = 0; col < colGenes.size(); ++col) {
-                        score_t currentScore = calculateSimilarity(rowGene, colGenes[col]);
-                        scores.setScoreAt(row, col, currentScore);
-                        bestRows.addCandidate(row, currentScore, col);
+    Homology<K>::calculateTile(
+        genome_t::gene_ctr rowGenes, genome_t::order_ctr rowOrder, const range_t rowPositions,
+        genome_t::gene_ctr colGenes, genome_t::order_ctr colOrder, const range_t colPositions,
+        const ranges_t& ranges, const index_t vocabularySize,
+        const SimilarityKernel kernel, const invertedIndex_t& index,
+        const score_t minScore, const bool triangular,
+        BBHcandidatesContainer_tr bestRows, ScoresContainer* scores, TriangularScoresContainer* triangularScores, SparseScoresContainer* sparseScores, columnHits_tp columnHits,
+        bestScores_tr bestRowScores, bestScores_tr bestCols,
+        std::mutex& rowsMutex, const index_t tileSlot, pruningCounters_tr counters
+    ) const {
+        std::size_t pruned = 0, aborted = 0, computed = 0;
+
+        // array denso e accumulatore per thread, riusati da tutti i tile e da tutte le coppie di genomi
+        denseProfile_tr rowProfile = getThreadProfile();
+        accumulator_tr accumulator = getThreadAccumulator();
+        const bool scatterGather = kernel == SimilarityKernel::scatterGather;
+        const bool inverted = kernel == SimilarityKernel::invertedIndex;
+        if(scatterGather)
+            rowProfile.reserve(vocabularySize);
+        if(inverted)
+            accumulator.reserve(colGenes.size());
+
+        // migliori colonne della riga corrente all'interno del tile
+        std::vector<index_t> localBestCols;
+        // punteggi che raggiungono il migliore della colonna (motore streaming), slot riservato al tile
+        columnHits_t::hits_t* hits = columnHits != nullptr ? &columnHits->getSlot(tileSlot) : nullptr;
+        // punteggi non nulli del tile (motore sparse)
+        SparseScoresContainer::buffer_t sparseBuffer;
+
+        for(index_t rowPosition = rowPositions.first; rowPosition < rowPositions.second; ++rowPosition) {
+            index_t row = rowOrder[rowPosition];
+            gene_tr rowGene = rowGenes[row];
+            const range_t& range = ranges[row];
+
+            index_t first = range.first > colPositions.first ? range.first : colPositions.first;
+            index_t second = range.second < colPositions.second ? range.second : colPositions.second;
+            if(first >= second)
+                continue;
+
+            score_t localBest = 0;
+            localBestCols.clear();
+
+            if(scatterGather)
+                rowProfile.scatter(*rowGene.getKmerContainer());
+            if(inverted)
+                accumulator.accumulate(*rowGene.getKmerContainer(), index);
+
+            for(index_t position = first; position < second; ++position) {
+                index_t col = colOrder[position];
+                // solo il triangolo superiore
+                if(triangular && col <= row)
+                    continue;
+                gene_tr colGene = colGenes[col];
+
+                // punteggi sotto al minimo vengono scartati, quelli sotto sia al migliore della riga
+                // che al migliore della colonna non cambiano ne' i candidati della riga
+                // ne' il massimo della colonna in checkForBBH
+                score_t rowBest = bestRowScores.getBestScore(row);
+                score_t colBest = bestCols.getBestScore(col);
+                score_t threshold = rowBest < colBest ? rowBest : colBest;
+                threshold = threshold < minScore ? minScore : threshold;
+
+                if(calculateUpperBound(rowGene, colGene) < threshold) {
+                    ++pruned;
+                    continue;
+                }
+
+                bool stopped = false;
+                score_t currentScore = calculateKernelSimilarity(kernel, rowProfile, accumulator, rowGene, colGene, col, threshold, stopped);
+                if(stopped) {
+                    ++aborted;
+                    continue;
+                }
+                ++computed;
+
+                if(currentScore >= minScore) {
+                    if(scores != nullptr)
+                        scores->setScoreAt(row, col, currentScore);
+                    if(triangularScores != nullptr)
+                        triangularScores->setScoreAt(row, col, currentScore);
+                    if(sparseScores != nullptr && currentScore > 0) {
+                        SparseScoresContainer::Triple triple;
+                        triple.row = static_cast<std::uint32_t>(row);
+                        triple.col = static_cast<std::uint32_t>(col);
+                        triple.score = ScoreCodec::encode(currentScore);
+                        sparseBuffer.push_back(triple);
+                    }
+                    bestRowScores.update(row, currentScore);
+                    bestCols.update(col, currentScore);
+
+                    // il migliore della colonna puo' solo crescere, punteggi sotto di esso non servono
+                    if(hits != nullptr && currentScore > 0 && currentScore >= bestCols.getBestScore(col)) {
+                        columnHits_t::Hit hit;
+                        hit.row = static_cast<std::uint32_t>(row);
+                        hit.col = static_cast<std::uint32_t>(col);
+                        hit.score = currentScore;
+                        hits->push_back(hit);
+                    }
+
+                    if(currentScore > localBest) {
+                        localBest = currentScore;
+                        localBestCols.clear();
+                        localBestCols.emplace_back(col);
+                    } else if(currentScore == localBest) {
+                        localBestCols.emplace_back(col);
                     }
                 }
-            );
-        }
-        // poolRef.waitTasks();
-        while(!poolRef.tasksCompleted()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            // i kmer della riga possono essere eliminati prima del prossimo tile di questo thread
+            if(scatterGather)
+                rowProfile.reset();
+            if(inverted)
+                accumulator.reset();
+
+            if(!localBestCols.empty()) {
+                std::unique_lock<std::mutex> lock(rowsMutex);
+                for(auto col = localBestCols.begin(); col != localBestCols.end(); ++col)
+                    bestRows.addCandidate(row, localBest, *col);
+            }
         }
-    }
 
+        if(sparseScores != nullptr)
+            sparseScores->appendScores(sparseBuffer);
+
+        counters.add(0, pruned, aborted, computed);
+    }
 
     
-    inline Homology::score_t
-    Homology::checkForBBH (
+    template<shared::kType K>
+    inline typename Homology<K>::score_t
+    Homology<K>::checkForBBH (
         const genome_t::gene_ctr colGenes, const genome_t::gene_ctr rowGenes,
         BBHcandidatesContainer_tr candidates,
-        ScoresContainer &scores
+        ScoresContainer &scores,
+        edges_tr edges
     ) {
         
         score_t sharedMin = 2;
         std::mutex minMutex;
 
         auto& poolRef = *pool_;
+        taskGroup_t group(poolRef);
 
-        // auto matchp = candidates.getPossibleMatch(rowGenes.size());
-        auto matchp = candidates.getPossibleMatch(colGenes.size(), poolRef);
+        const auto match = candidates.getPossibleMatch(colGenes.size(), poolRef);
 
-        auto& match = *matchp; 
         
-        // BBHcandidatesContainer_t::set_tr matchRef = *match;
-        // bbh::BidirectionalBestHitContainer& bbhContainerRef = *bbh;
         // passo per tutte le colonne "candidate"
 
-        for(auto col = match.begin(); col != match.end(); ++col) {
-            const auto& currentColRef = *col;
-            
-            
-                poolRef.execute(
-                    [&currentColRef, &colGenes, &rowGenes, &scores, &candidates, this, &sharedMin, &minMutex] {
-                        
-                        auto& fwRef = *fw;
-                        score_t bestScore = -1;
-                        
-
-                        std::unordered_set<index_t> currentBestIndexs;
-
-                        // index_t colGeneId = currentColRef.first;
-                        index_t colGeneId = currentColRef;;
-                        gene_tr currentColGene = colGenes[colGeneId];
+        // colonne candidate ordinate, divise in intervalli di costo simile
+        auto ranges = BBHcandidatesContainer_t::getBalancedRanges(match, 4 * poolRef.getTotalThread(), false);
+        for(auto range = ranges.begin(); range != ranges.end(); ++range) {
+            const BBHcandidatesContainer_t::range_t currentRange = *range;
+            group.execute(
+                [currentRange, &match, &colGenes, &rowGenes, &scores, &candidates, this, &sharedMin, &minMutex, &edges] {
+                    // righe con il punteggio migliore della colonna, in ordine: riusate da ogni colonna del task
+                    std::vector<index_t> currentBestIndexs;
+                    for(index_t position = currentRange.first; position < currentRange.second; ++position) {
+                        const index_t currentColRef = match[position];
+                        stored_t bestScore = 0;
+                        currentBestIndexs.clear();
+
+                        index_t colGeneId = currentColRef;
                         // estrae le migliori righe per la colonna corrente
                         // e li memorizza in current best indexs
 
                         for(index_t row = 0; row < rowGenes.size(); ++row) {
-                            score_t currentScore = scores.getScoreAt(row, colGeneId);
+                            stored_t currentScore = scores.getScoreAt(row, colGeneId);
 
-                            if(currentScore > bestScore && currentScore > 0.0) {
+                            if(currentScore > bestScore) {
                                 bestScore = currentScore;
                                 currentBestIndexs.clear();
-                                currentBestIndexs.emplace(row);
-                            } else if(currentScore == bestScore && currentScore > 0.0) {
-                                currentBestIndexs.emplace(row);
+                                currentBestIndexs.push_back(row);
+                            } else if(currentScore == bestScore && currentScore > 0) {
+                                currentBestIndexs.push_back(row);
                             }
                         }
 
                         // passa per tutte le righe con il punteggio migliore
                         // e se quel punteggio è il migliore anche per la riga
                         // crea il bbh
-                        if(bestScore > 0.0) {
+                        if(bestScore > 0) {
 
                             score_t minBBH = 2;
-                    
-                            index_t currentColGeneFileLine = currentColGene.getGeneFilePosition();
-                    
+
+
                             for(auto index = currentBestIndexs.begin(); index != currentBestIndexs.end(); ++index) {
                                 index_t currentIndex = *index;
-                                
-                                if(bestScore == candidates.getBestScoreForCandidate(currentIndex)) {
-                                    fwRef.write(
-                                        std::to_string(
-                                            rowGenes[currentIndex].getGeneFilePosition()
-                                        ) + "," +
-                                        std::to_string(
-                                            currentColGeneFileLine
-                                        ) + "," +
-                                        std::to_string(bestScore)
-                                        , outStream_);
-                                    minBBH = bestScore < minBBH ? bestScore : minBBH;
+
+                                // il punteggio memorizzato e' codificato, quello della riga e' esatto
+                                score_t rowBestScore = candidates.getBestScoreForCandidate(currentIndex);
+                                if(bestScore == ScoreCodec::encode(rowBestScore)) {
+                                    edges.add(currentIndex, colGeneId, rowBestScore);
+                                    minBBH = rowBestScore < minBBH ? rowBestScore : minBBH;
                                 }
                             }
                             if(minBBH < sharedMin) {
@@ -629,98 +2655,185 @@ namespace homology {
                                 sharedMin = minBBH < sharedMin ? minBBH : sharedMin;
                             }
                         }
-
-                        
                     }
-                );
+                }
+            );
         }
-        // poolRef.waitTasks();
 
-        while(!poolRef.tasksCompleted()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        }
+        group.wait();
         
-        // poolRef.waitTasks();
 
-        delete matchp;
         return sharedMin;
     }
 
+    template<shared::kType K>
+    inline typename Homology<K>::score_t
+    Homology<K>::checkForBBH (
+        BBHcandidatesContainer_tr candidates,
+        const bestScores_t& bestCols,
+        columnHits_tr columnHits,
+        edges_tr edges
+    ) {
+        score_t minBBH = 2;
+
+        // un solo passaggio sui punteggi che hanno raggiunto il migliore della colonna:
+        // quelli superati in seguito hanno un punteggio minore del migliore finale
+        for(index_t slot = 0; slot < columnHits.getSlotsNumber(); ++slot) {
+            const columnHits_t::hits_t& hits = columnHits.getSlot(slot);
+            for(auto hit = hits.begin(); hit != hits.end(); ++hit) {
+                if(hit->score == bestCols.getBestScore(hit->col) && hit->score == candidates.getBestScoreForCandidate(hit->row)) {
+                    edges.add(hit->row, hit->col, hit->score);
+                    minBBH = hit->score < minBBH ? hit->score : minBBH;
+                }
+            }
+        }
+
+        return minBBH;
+    }
+
+    template<shared::kType K>
+    inline typename Homology<K>::score_t
+    Homology<K>::checkForBBH (
+        const genome_t::gene_ctr colGenes, const genome_t::gene_ctr rowGenes,
+        BBHcandidatesContainer_tr candidates,
+        const SparseScoresContainer& scores,
+        edges_tr edges
+    ) {
+        score_t sharedMin = 2;
+        std::mutex minMutex;
+
+        auto& poolRef = *pool_;
+        taskGroup_t group(poolRef);
+
+        // intervalli di colonne con circa lo stesso numero di punteggi non nulli
+        const index_t chunks = 4 * poolRef.getTotalThread();
+        const index_t chunkSize = scores.getNonZeros() / chunks + 1;
+
+        index_t first = 0;
+        while(first < colGenes.size()) {
+            index_t last = first;
+            index_t nonZeros = 0;
+            while(last < colGenes.size() && nonZeros < chunkSize) {
+                nonZeros += scores.getColumnEnd(last) - scores.getColumnBegin(last);
+                ++last;
+            }
+
+            group.execute(
+                [first, last, &colGenes, &rowGenes, &scores, &candidates, this, &sharedMin, &minMutex, &edges] {
+                    score_t minBBH = 2;
+                    std::vector<index_t> currentBestIndexs;
+
+                    for(index_t col = first; col < last; ++col) {
+                        stored_t bestScore = 0;
+                        currentBestIndexs.clear();
+
+                        // estrae le migliori righe della colonna tra i soli punteggi non nulli
+                        const SparseScoresContainer::Entry* end = scores.getColumnEnd(col);
+                        for(const SparseScoresContainer::Entry* entry = scores.getColumnBegin(col); entry != end; ++entry) {
+                            if(entry->score > bestScore) {
+                                bestScore = entry->score;
+                                currentBestIndexs.clear();
+                                currentBestIndexs.push_back(entry->row);
+                            } else if(entry->score == bestScore) {
+                                currentBestIndexs.push_back(entry->row);
+                            }
+                        }
+
+                        if(bestScore == 0)
+                            continue;
+
+                        for(auto index = currentBestIndexs.begin(); index != currentBestIndexs.end(); ++index) {
+                            // il punteggio memorizzato e' codificato, quello della riga e' esatto
+                            score_t rowBestScore = candidates.getBestScoreForCandidate(*index);
+                            if(bestScore == ScoreCodec::encode(rowBestScore)) {
+                                edges.add(*index, col, rowBestScore);
+                                minBBH = rowBestScore < minBBH ? rowBestScore : minBBH;
+                            }
+                        }
+                    }
+
+                    if(minBBH < sharedMin) {
+                        std::unique_lock<std::mutex> lock(minMutex);
+                        sharedMin = minBBH < sharedMin ? minBBH : sharedMin;
+                    }
+                }
+            );
+
+            first = last;
+        }
+
+        group.wait();
+
+        return sharedMin;
+    }
+
+    template<shared::kType K>
     inline void
-    Homology::checkForBBHSame (
+    Homology<K>::checkForBBHSame (
         const genome_t::gene_ctr genes, 
         BBHcandidatesContainer_tr candidates,
-        ScoresContainer& scores
+        const TriangularScoresContainer& scores,
+        edges_tr edges
     ) {
         auto& poolRef = *pool_;
+        taskGroup_t group(poolRef);
 
-        auto matchp = candidates.getPossibleMatch(genes.size(), poolRef);
-        // auto matchp = candidates.getPossibleMatch(genes.size());
-        auto& match = *matchp; 
-        // BBHcandidatesContainer_t::set_tr matchRef = *match;
+        const auto match = candidates.getPossibleMatch(genes.size(), poolRef);
         
-        // bbh::BidirectionalBestHitContainer& bbhContainerRef = *bbh;
         
         // passo per tutte le colonne "candidate"
-        for(auto col = match.begin(); col != match.end(); ++col) {
-            const auto& currentColRef = *col;
-            poolRef.execute(
-                [&currentColRef, &genes, &scores, &candidates, this] {
-                    auto& fwRef = *fw;
-                    score_t bestScore = -1;
-
-                    std::unordered_set<index_t> currentBestIndexs;
-                    // index_t colGeneId = currentColRef.first;
-                    index_t colGeneId = currentColRef;
-                    gene_tr currentColGene = genes[colGeneId];
-                    // estrae le migliori righe per la colonna corrente
-                    // e li memorizza in current best indexs
-
-                    // le prime righe fino alla diagonale
-                    for(index_t row = 0; row < colGeneId; ++row) {
-                        score_t currentScore = scores.getScoreAt(row, colGeneId);
-
-                        if(currentScore > bestScore && currentScore > 0.0) {
-                            bestScore = currentScore;
-                            currentBestIndexs.clear();
-                            currentBestIndexs.insert(row);
-                        } else if(currentScore == bestScore && currentScore > 0.0) {
-                            currentBestIndexs.insert(row);
+        // colonne candidate ordinate, divise in intervalli di costo simile
+        auto ranges = BBHcandidatesContainer_t::getBalancedRanges(match, 4 * poolRef.getTotalThread(), true);
+        for(auto range = ranges.begin(); range != ranges.end(); ++range) {
+            const BBHcandidatesContainer_t::range_t currentRange = *range;
+            group.execute(
+                [currentRange, &match, &genes, &scores, &candidates, this, &edges] {
+                    // righe con il punteggio migliore della colonna, in ordine: riusate da ogni colonna del task
+                    std::vector<index_t> currentBestIndexs;
+                    for(index_t position = currentRange.first; position < currentRange.second; ++position) {
+                        const index_t currentColRef = match[position];
+                        stored_t bestScore = 0;
+                        currentBestIndexs.clear();
+                        index_t colGeneId = currentColRef;
+                        // estrae le migliori righe per la colonna corrente
+                        // e li memorizza in current best indexs
+
+                        // le prime righe fino alla diagonale, contigue in memoria
+                        const stored_t* column = scores.getColumn(colGeneId);
+                        for(index_t row = 0; row < colGeneId; ++row) {
+                            stored_t currentScore = column[row];
+
+                            if(currentScore > bestScore) {
+                                bestScore = currentScore;
+                                currentBestIndexs.clear();
+                                currentBestIndexs.push_back(row);
+                            } else if(currentScore == bestScore && currentScore > 0) {
+                                currentBestIndexs.push_back(row);
+                            }
                         }
-                    }
 
-                    // passa per tutte le righe con il punteggio migliore
-                    // e se quel punteggio è il migliore anche per la riga
-                    // crea il bbh
+                        // passa per tutte le righe con il punteggio migliore
+                        // e se quel punteggio è il migliore anche per la riga
+                        // crea il bbh
+
+                        if(bestScore > 0) {
+                            for(auto index = currentBestIndexs.begin(); index != currentBestIndexs.end(); ++index) {
+                                index_t currentIndex = *index;
+
+                                // il punteggio memorizzato e' codificato, quello della riga e' esatto
+                                score_t rowBestScore = candidates.getBestScoreForCandidate(currentIndex);
+                                if(bestScore == ScoreCodec::encode(rowBestScore)) {
+                                    edges.add(currentIndex, colGeneId, rowBestScore);
 
-                    if(bestScore > 0.0) {
-                        index_t currentColGeneFileLine = currentColGene.getGeneFilePosition();
-                        for(auto index = currentBestIndexs.begin(); index != currentBestIndexs.end(); ++index) {
-                            index_t currentIndex = *index;
-
-                            if(bestScore == candidates.getBestScoreForCandidate(currentIndex)) {
-                                fwRef.write(
-                                    std::to_string(
-                                        genes[currentIndex].getGeneFilePosition()
-                                    ) + "," +
-                                    std::to_string(
-                                        currentColGeneFileLine
-                                    ) + "," +
-                                    std::to_string(bestScore)
-                                    , outStream_);
-                                
+                                }
                             }
                         }
                     }
                 }
             );
         }
-        // poolRef.waitTasks();
 
-        while(!poolRef.tasksCompleted()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        }
-        delete matchp;
+        group.wait();
     }
     
 }
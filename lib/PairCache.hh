@@ -0,0 +1,268 @@
+#ifndef PAIR_CACHE_INCLUDE_GUARD
+#define PAIR_CACHE_INCLUDE_GUARD 1
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <atomic>
+#include <iostream>
+#include <stdexcept>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "VariablesTypes.hh"
+#include "bbh/EdgesContainer.hh"
+
+
+/**
+ * @file PairCache.hh
+ * @brief Definitions for the PairCache class.
+ */
+
+/**
+ * @namespace homology
+ * @brief Namespace containing definitions for homology computation related classes.
+ */
+
+namespace homology {
+
+    /**
+     * @class PairCache
+     * @brief The BBH of the genome pairs computed by any run, kept in a directory shared by the runs.
+     *
+     * The BBH of two different genomes depend only on their genes, k and the discard value: a pair is
+     * stored in a file named after the hashes of the two genomes (see RunState::hashGenome), k and the
+     * discard value, with its minimum BBH score and its edges (bbh::EdgesContainer, genes as indexes in
+     * their genomes). Any dataset containing the two genomes, in any position and order, reads the pair
+     * instead of computing it. A file is written under a temporary name and renamed, so runs sharing the
+     * directory at the same time never read a partial pair. The number of genes of the two genomes is
+     * stored too and checked when the pair is looked up and read.
+     *
+     * File layout (native byte order): "PDPAIR01", genes of the row genome, genes of the column genome,
+     * minimum, number of edges, edges.
+     */
+    class PairCache {
+        public:
+            using hash_t = std::uint64_t;
+            using score_t = shared::scoreType;
+            using edges_t = bbh::EdgesContainer::edges_t;
+
+        private:
+            using index_t = shared::indexType;
+            using edge_t = bbh::EdgesContainer::Edge;
+
+            struct Header {
+                char magic[8];
+                std::uint64_t rowGenes;
+                std::uint64_t colGenes;
+                score_t min;
+                std::uint64_t edges;
+            };
+
+            std::string directory_;
+            // parte finale del nome dei file: k e scarto
+            std::string suffix_;
+            std::atomic<std::size_t> hits_;
+            std::atomic<std::size_t> misses_;
+            std::atomic<std::size_t> stores_;
+            std::atomic<std::size_t> tmpCounter_;
+
+            /**
+             * @brief Gets the file of a pair.
+             */
+            inline std::string getPath(const hash_t row, const hash_t col) const;
+
+            /**
+             * @brief Opens the file of a pair and reads its header.
+             * @return The file positioned at the edges, nullptr if the file does not exist or does not match
+             *         the genes of the genomes.
+             */
+            inline std::FILE* openPair(const std::string& path, const index_t rowGenes, const index_t colGenes, Header& header) const;
+
+            /**
+             * @brief Reads the file of a pair.
+             * @return False if the file does not exist or does not match the genes of the genomes.
+             */
+            inline bool read(const std::string& path, const index_t rowGenes, const index_t colGenes, score_t& min, edges_t& edges) const;
+
+        public:
+            /**
+             * @brief Constructs the cache, the directory is created if missing.
+             * @param directory The directory of the pairs.
+             * @param k The length of kmers of the run.
+             * @param discard The discard value of the run.
+             */
+            inline explicit PairCache(const std::string& directory, const shared::kType k, const score_t discard);
+
+            PairCache(const PairCache&) = delete;
+            PairCache& operator=(const PairCache&) = delete;
+            PairCache(PairCache&&) = delete;
+            PairCache& operator=(PairCache&&) = delete;
+
+            /**
+             * @brief Default destructor.
+             */
+            ~PairCache() = default;
+
+            /**
+             * @brief Checks if a pair is in the cache, in any order, with the same checks of find, thread safe.
+             * @param row The hash of the row genome.
+             * @param col The hash of the column genome.
+             * @param rowGenes The number of genes of the row genome.
+             * @param colGenes The number of genes of the column genome.
+             * @return True if the pair is in the cache.
+             */
+            inline bool contains(const hash_t row, const hash_t col, const index_t rowGenes, const index_t colGenes) const;
+
+            /**
+             * @brief Reads a pair, thread safe.
+             * @param row The hash of the row genome.
+             * @param col The hash of the column genome.
+             * @param rowGenes The number of genes of the row genome.
+             * @param colGenes The number of genes of the column genome.
+             * @param min Set to the minimum BBH score of the pair.
+             * @param edges Set to the edges of the pair.
+             * @param transposed Set to true if the pair was computed with the genomes swapped.
+             * @return False if the pair is not in the cache.
+             */
+            inline bool find(const hash_t row, const hash_t col, const index_t rowGenes, const index_t colGenes, score_t& min, edges_t& edges, bool& transposed);
+
+            /**
+             * @brief Writes a pair, thread safe.
+             * @param row The hash of the row genome.
+             * @param col The hash of the column genome.
+             * @param rowGenes The number of genes of the row genome.
+             * @param colGenes The number of genes of the column genome.
+             * @param min The minimum BBH score of the pair.
+             * @param edges The edges of the pair.
+             */
+            inline void store(const hash_t row, const hash_t col, const index_t rowGenes, const index_t colGenes, const score_t min, const edges_t& edges);
+
+            /**
+             * @brief Prints the number of pairs read, not found and written.
+             * @param os The output stream.
+             */
+            inline void print(std::ostream& os) const;
+    };
+
+    inline
+    PairCache::PairCache(const std::string& directory, const shared::kType k, const score_t discard)
+    : directory_(directory), hits_(0), misses_(0), stores_(0), tmpCounter_(0) {
+        if(mkdir(directory_.c_str(), 0777) != 0 && errno != EEXIST)
+            throw std::runtime_error("pair cache " + directory_ + ": " + std::strerror(errno));
+
+        // lo scarto con i suoi bit: valori diversi danno sempre file diversi
+        std::uint64_t discardBits = 0;
+        std::memcpy(&discardBits, &discard, sizeof(discard) < sizeof(discardBits) ? sizeof(discard) : sizeof(discardBits));
+        char suffix[64];
+        std::snprintf(suffix, sizeof(suffix), "-k%llu-d%016llx.bbh", static_cast<unsigned long long>(k), static_cast<unsigned long long>(discardBits));
+        suffix_ = suffix;
+    }
+
+    inline std::string
+    PairCache::getPath(const hash_t row, const hash_t col) const {
+        char name[40];
+        std::snprintf(name, sizeof(name), "/%016llx-%016llx", static_cast<unsigned long long>(row), static_cast<unsigned long long>(col));
+        return directory_ + name + suffix_;
+    }
+
+    inline std::FILE*
+    PairCache::openPair(const std::string& path, const index_t rowGenes, const index_t colGenes, Header& header) const {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if(file == nullptr)
+            return nullptr;
+
+        bool valid =
+            std::fread(&header, sizeof(header), 1, file) == 1 &&
+            std::memcmp(header.magic, "PDPAIR01", sizeof(header.magic)) == 0 &&
+            header.rowGenes == rowGenes && header.colGenes == colGenes;
+        if(!valid) {
+            std::fclose(file);
+            return nullptr;
+        }
+        return file;
+    }
+
+    inline bool
+    PairCache::contains(const hash_t row, const hash_t col, const index_t rowGenes, const index_t colGenes) const {
+        // un file di un'altra versione o di genomi diversi con lo stesso hash verrebbe scartato da find
+        Header header;
+        std::FILE* file = openPair(getPath(row, col), rowGenes, colGenes, header);
+        if(file == nullptr)
+            file = openPair(getPath(col, row), colGenes, rowGenes, header);
+        if(file == nullptr)
+            return false;
+        std::fclose(file);
+        return true;
+    }
+
+    inline bool
+    PairCache::read(const std::string& path, const index_t rowGenes, const index_t colGenes, score_t& min, edges_t& edges) const {
+        Header header;
+        std::FILE* file = openPair(path, rowGenes, colGenes, header);
+        if(file == nullptr)
+            return false;
+
+        edges.resize(header.edges);
+        bool valid = header.edges == 0 || std::fread(edges.data(), sizeof(edge_t), header.edges, file) == header.edges;
+        min = header.min;
+        std::fclose(file);
+        return valid;
+    }
+
+    inline bool
+    PairCache::find(const hash_t row, const hash_t col, const index_t rowGenes, const index_t colGenes, score_t& min, edges_t& edges, bool& transposed) {
+        transposed = false;
+        if(!read(getPath(row, col), rowGenes, colGenes, min, edges)) {
+            // coppia calcolata con i genomi in ordine inverso
+            transposed = true;
+            if(!read(getPath(col, row), colGenes, rowGenes, min, edges)) {
+                ++misses_;
+                return false;
+            }
+        }
+        ++hits_;
+        return true;
+    }
+
+    inline void
+    PairCache::store(const hash_t row, const hash_t col, const index_t rowGenes, const index_t colGenes, const score_t min, const edges_t& edges) {
+        std::string path = getPath(row, col);
+        // nome temporaneo unico anche tra processi diversi
+        std::string tmpPath = path + ".tmp" + std::to_string(getpid()) + "-" + std::to_string(tmpCounter_++);
+
+        std::FILE* file = std::fopen(tmpPath.c_str(), "wb");
+        if(file == nullptr)
+            throw std::runtime_error("pair cache " + tmpPath + ": " + std::strerror(errno));
+
+        Header header;
+        std::memcpy(header.magic, "PDPAIR01", sizeof(header.magic));
+        header.rowGenes = rowGenes;
+        header.colGenes = colGenes;
+        header.min = min;
+        header.edges = edges.size();
+        bool failed = std::fwrite(&header, sizeof(header), 1, file) != 1;
+        if(!edges.empty())
+            failed = std::fwrite(edges.data(), sizeof(edge_t), edges.size(), file) != edges.size() || failed;
+        failed = std::fclose(file) != 0 || failed;
+
+        if(failed || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+            std::remove(tmpPath.c_str());
+            throw std::runtime_error("writing pair cache " + path);
+        }
+        ++stores_;
+    }
+
+    inline void
+    PairCache::print(std::ostream& os) const {
+        os<<"hits: "<<hits_<<", misses: "<<misses_<<", stored: "<<stores_;
+    }
+
+}
+
+
+#endif
@@ -0,0 +1,277 @@
+#ifndef PAIR_WORKSPACE_INCLUDE_GUARD
+#define PAIR_WORKSPACE_INCLUDE_GUARD 1
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <string>
+
+#include "VariablesTypes.hh"
+#include "ScoresContainer.hh"
+#include "SparseScoresContainer.hh"
+#include "TriangularScoresContainer.hh"
+#include "bbh/BBHCandidatesContainer.hh"
+#include "bbh/BestScoresContainer.hh"
+#include "bbh/ColumnHitsContainer.hh"
+#include "bbh/EdgesContainer.hh"
+#include "kmers/KmersInvertedIndex.hh"
+
+
+/**
+ * @file PairWorkspace.hh
+ * @brief Definitions for the PairWorkspace and PairWorkspacePool classes.
+ */
+
+/**
+ * @namespace homology
+ * @brief Namespace containing definitions for homology computation related classes.
+ */
+
+namespace homology {
+
+    /**
+     * @class PairWorkspace
+     * @brief The containers needed to compute one genome pair, reused from a pair to the next.
+     *
+     * Every getter resets the container to the size of the current pair and returns it: the memory
+     * grows to the largest pair seen and is never freed between pairs, the candidates are emptied by
+     * starting a new epoch instead of clearing them.
+     */
+    class PairWorkspace {
+        public:
+            // un mutex per blocco di righe dei tile
+            using rowsMutexes_t = std::vector<std::mutex>;
+
+        private:
+            using index_t = shared::indexType;
+
+            bbh::BBHCandidatesContainer bestRows_;
+            bbh::BestScoresContainer bestCols_;
+            bbh::BestScoresContainer bestRowScores_;
+            rowsMutexes_t rowsMutexes_;
+            kmers::KmersInvertedIndex invertedIndex_;
+            bbh::ColumnHitsContainer columnHits_;
+            score::ScoresContainer scores_;
+            score::TriangularScoresContainer triangularScores_;
+            score::SparseScoresContainer sparseScores_;
+            bbh::EdgesContainer edges_;
+            bbh::EdgesContainer::edges_t previousEdges_;
+            std::string output_;
+
+        public:
+            /**
+             * @brief Constructs an empty workspace, the containers are sized by the getters.
+             */
+            inline PairWorkspace();
+
+            PairWorkspace(const PairWorkspace&) = delete;
+            PairWorkspace(PairWorkspace&&) = delete;
+            PairWorkspace& operator=(const PairWorkspace&) = delete;
+            PairWorkspace& operator=(PairWorkspace&&) = delete;
+
+            /**
+             * @brief Default destructor.
+             */
+            ~PairWorkspace() = default;
+
+            /**
+             * @brief The best columns of every row, emptied.
+             * @param rows Number of rows of the pair.
+             */
+            inline bbh::BBHCandidatesContainer& getBestRows(const index_t rows);
+
+            /**
+             * @brief The best score of every column, set to 0.
+             * @param cols Number of columns of the pair.
+             */
+            inline bbh::BestScoresContainer& getBestCols(const index_t cols);
+
+            /**
+             * @brief The best score of every row, set to 0.
+             * @param rows Number of rows of the pair.
+             */
+            inline bbh::BestScoresContainer& getBestRowScores(const index_t rows);
+
+            /**
+             * @brief The mutexes of the blocks of rows of the tiles, grown by calculateTiles.
+             */
+            inline rowsMutexes_t& getRowsMutexes() noexcept {
+                return rowsMutexes_;
+            }
+
+            /**
+             * @brief The inverted index of the column genes, not built: built by calculateTiles when its kernel is used.
+             */
+            inline kmers::KmersInvertedIndex& getInvertedIndex();
+
+            /**
+             * @brief The column hits of the streaming engine, resized by calculateTiles.
+             */
+            inline bbh::ColumnHitsContainer& getColumnHits();
+
+            /**
+             * @brief The score matrix of the matrix engine, set to 0.
+             * @param rows Number of rows of the pair.
+             * @param cols Number of columns of the pair.
+             */
+            inline score::ScoresContainer& getScores(const index_t rows, const index_t cols);
+
+            /**
+             * @brief The triangular score matrix of the matrix engine for a genome with itself, set to 0.
+             * @param genes Number of genes of the genome.
+             */
+            inline score::TriangularScoresContainer& getTriangularScores(const index_t genes);
+
+            /**
+             * @brief The nonzero scores of the sparse engine, emptied.
+             * @param rows Number of rows of the pair.
+             * @param cols Number of columns of the pair.
+             */
+            inline score::SparseScoresContainer& getSparseScores(const index_t rows, const index_t cols);
+
+            /**
+             * @brief The BBH of the pair, emptied.
+             */
+            inline bbh::EdgesContainer& getEdges();
+
+            /**
+             * @brief The BBH of the pair read from a previous run, overwritten by the reader.
+             */
+            inline bbh::EdgesContainer::edges_t& getPreviousEdges() noexcept {
+                return previousEdges_;
+            }
+
+            /**
+             * @brief The lines of the BBH of the pair, written to the output when the pair is complete, emptied.
+             */
+            inline std::string& getOutput();
+    };
+
+    /**
+     * @class PairWorkspacePool
+     * @brief Hands out PairWorkspace objects to the genome pairs being computed, creating a new one only
+     *        when all the existing ones are in use (one per pair computed at the same time).
+     */
+    class PairWorkspacePool {
+        private:
+            using workspace_tp = PairWorkspace*;
+            using workspaces_t = std::vector<std::unique_ptr<PairWorkspace>>;
+            using free_t = std::vector<workspace_tp>;
+
+            workspaces_t workspaces_;
+            free_t free_;
+            std::mutex mutex_;
+
+        public:
+            /**
+             * @brief Constructs an empty pool.
+             */
+            PairWorkspacePool() = default;
+
+            PairWorkspacePool(const PairWorkspacePool&) = delete;
+            PairWorkspacePool(PairWorkspacePool&&) = delete;
+            PairWorkspacePool& operator=(const PairWorkspacePool&) = delete;
+            PairWorkspacePool& operator=(PairWorkspacePool&&) = delete;
+
+            /**
+             * @brief Default destructor, frees every workspace.
+             */
+            ~PairWorkspacePool() = default;
+
+            /**
+             * @brief Takes a free workspace, thread safe.
+             * @return The workspace, owned by the pool, to be given back with release.
+             */
+            inline workspace_tp acquire();
+
+            /**
+             * @brief Gives back a workspace taken with acquire, thread safe.
+             * @param workspace The workspace.
+             */
+            inline void release(workspace_tp workspace);
+    };
+
+    inline
+    PairWorkspace::PairWorkspace()
+    : bestRows_(0), bestCols_(0), bestRowScores_(0), scores_(0, 0, score::ScoresContainer::defaultBlockSide, true), triangularScores_(0), sparseScores_(0, 0) {}
+
+    inline bbh::BBHCandidatesContainer&
+    PairWorkspace::getBestRows(const index_t rows) {
+        bestRows_.reset(rows);
+        return bestRows_;
+    }
+
+    inline bbh::BestScoresContainer&
+    PairWorkspace::getBestCols(const index_t cols) {
+        bestCols_.reset(cols);
+        return bestCols_;
+    }
+
+    inline bbh::BestScoresContainer&
+    PairWorkspace::getBestRowScores(const index_t rows) {
+        bestRowScores_.reset(rows);
+        return bestRowScores_;
+    }
+
+    inline kmers::KmersInvertedIndex&
+    PairWorkspace::getInvertedIndex() {
+        invertedIndex_.reset();
+        return invertedIndex_;
+    }
+
+    inline bbh::ColumnHitsContainer&
+    PairWorkspace::getColumnHits() {
+        return columnHits_;
+    }
+
+    inline score::ScoresContainer&
+    PairWorkspace::getScores(const index_t rows, const index_t cols) {
+        scores_.reset(rows, cols);
+        return scores_;
+    }
+
+    inline score::TriangularScoresContainer&
+    PairWorkspace::getTriangularScores(const index_t genes) {
+        triangularScores_.reset(genes);
+        return triangularScores_;
+    }
+
+    inline score::SparseScoresContainer&
+    PairWorkspace::getSparseScores(const index_t rows, const index_t cols) {
+        sparseScores_.reset(rows, cols);
+        return sparseScores_;
+    }
+
+    inline bbh::EdgesContainer&
+    PairWorkspace::getEdges() {
+        edges_.reset();
+        return edges_;
+    }
+
+    inline std::string&
+    PairWorkspace::getOutput() {
+        output_.clear();
+        return output_;
+    }
+
+    inline PairWorkspacePool::workspace_tp
+    PairWorkspacePool::acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if(free_.empty()) {
+            workspaces_.emplace_back(new PairWorkspace());
+            return workspaces_.back().get();
+        }
+        workspace_tp workspace = free_.back();
+        free_.pop_back();
+        return workspace;
+    }
+
+    inline void
+    PairWorkspacePool::release(workspace_tp workspace) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        free_.push_back(workspace);
+    }
+
+}
+
+#endif
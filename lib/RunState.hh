@@ -0,0 +1,384 @@
+#ifndef RUN_STATE_INCLUDE_GUARD
+#define RUN_STATE_INCLUDE_GUARD 1
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <mutex>
+#include <stdexcept>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "VariablesTypes.hh"
+#include "bbh/EdgesContainer.hh"
+#include "genx/Genome.hh"
+
+
+/**
+ * @file RunState.hh
+ * @brief Definitions for the RunState class.
+ */
+
+/**
+ * @namespace homology
+ * @brief Namespace containing definitions for homology computation related classes.
+ */
+
+namespace homology {
+
+    /**
+     * @class RunState
+     * @brief The results of a run, saved to add genomes later without computing the pairs again.
+     *
+     * The state holds the genomes of the run, identified by a hash of their genes, and for every
+     * genome pair its minimum BBH score and its edges (bbh::EdgesContainer, with the genes as indexes
+     * in their genomes), then for every genome the edges of the comparison with itself together with
+     * the minimum of the genome used as its threshold. A run started from a previous state takes from
+     * it the pairs of genomes both already present, wherever they are in the new input, and the
+     * comparison of a genome with itself if its minimum has not changed: the output is the one of a
+     * run computing everything. The records are appended to the new state as the pairs complete and
+     * the state replaces the previous one only at the end of the run. Only runs with the same k and
+     * discard value can share a state.
+     *
+     * File layout (native byte order): "PDSTATE1", k, discard, number of genomes, hash and genes of
+     * every genome, then the records: type (pair or genome), row hash, column hash, minimum, number
+     * of edges, edges.
+     */
+    class RunState {
+        public:
+            using hash_t = std::uint64_t;
+            using score_t = shared::scoreType;
+            using edges_t = bbh::EdgesContainer::edges_t;
+            using hashes_t = std::vector<hash_t>;
+
+        private:
+            using index_t = shared::indexType;
+            using edge_t = bbh::EdgesContainer::Edge;
+            using key_t = std::pair<hash_t, hash_t>;
+
+            enum : std::uint8_t { pairRecord = 0, genomeRecord = 1 };
+
+            struct Record {
+                std::uint64_t offset;
+                std::uint64_t edges;
+                score_t min;
+            };
+
+            // intestazione di un record, seguita dagli archi
+            struct RecordHeader {
+                std::uint64_t type;
+                hash_t row;
+                hash_t col;
+                score_t min;
+                std::uint64_t edges;
+            };
+
+            std::uint64_t k_;
+            score_t discard_;
+
+            // stato precedente, letto su richiesta
+            int previousFd_;
+            std::map<key_t, Record> previousPairs_;
+            std::map<hash_t, Record> previousGenomes_;
+            index_t previousGenomesNumber_;
+
+            // nuovo stato, scritto in tmpPath_ e rinominato in path_ da commit
+            std::string path_;
+            std::string tmpPath_;
+            std::FILE* file_;
+            std::mutex mutex_;
+
+            /**
+             * @brief Reads exactly size bytes of the previous state.
+             */
+            inline void read(void* data, const std::size_t size, const std::uint64_t offset) const;
+
+            /**
+             * @brief Reads the edges of a record of the previous state.
+             */
+            inline void readEdges(const Record& record, edges_t& edges) const;
+
+            /**
+             * @brief Appends a record to the new state, thread safe.
+             */
+            inline void write(const std::uint64_t type, const hash_t row, const hash_t col, const score_t min, const edges_t& edges);
+
+        public:
+            /**
+             * @brief Constructs an empty state.
+             * @param k The length of kmers of the run.
+             * @param discard The discard value of the run.
+             */
+            inline explicit RunState(const shared::kType k, const score_t discard);
+
+            RunState(const RunState&) = delete;
+            RunState& operator=(const RunState&) = delete;
+            RunState(RunState&&) = delete;
+            RunState& operator=(RunState&&) = delete;
+
+            /**
+             * @brief Closes the files, the new state is discarded if commit has not been called.
+             */
+            inline ~RunState();
+
+            /**
+             * @brief Computes the hash of the genes of a genome, in their order.
+             * @param genome The genome.
+             * @return The hash (64 bit FNV-1a).
+             */
+            inline static hash_t hashGenome(genome::Genome& genome);
+
+            /**
+             * @brief Loads the index of the records of a previous state, read on demand during the run.
+             * @param path The file of the previous state.
+             */
+            inline void load(const std::string& path);
+
+            /**
+             * @brief Gets the number of genomes of the previous state.
+             * @return The number of genomes, 0 without a previous state.
+             */
+            inline index_t getPreviousGenomesNumber() const noexcept {
+                return previousGenomesNumber_;
+            }
+
+            /**
+             * @brief Starts the new state of the run.
+             * @param path The file of the new state, it may be the same of the previous state.
+             * @param hashes The hash of every genome.
+             * @param genes The number of genes of every genome.
+             */
+            inline void create(const std::string& path, const hashes_t& hashes, const std::vector<index_t>& genes);
+
+            /**
+             * @brief Checks if the previous state has a genome pair, in any order.
+             * @param row The hash of the row genome.
+             * @param col The hash of the column genome.
+             * @return True if the pair is in the previous state.
+             */
+            inline bool hasPair(const hash_t row, const hash_t col) const;
+
+            /**
+             * @brief Reads a genome pair of the previous state, thread safe.
+             * @param row The hash of the row genome.
+             * @param col The hash of the column genome.
+             * @param min Set to the minimum BBH score of the pair.
+             * @param edges Set to the edges of the pair.
+             * @param transposed Set to true if the pair was computed with the genomes swapped.
+             * @return False if the pair is not in the previous state.
+             */
+            inline bool findPair(const hash_t row, const hash_t col, score_t& min, edges_t& edges, bool& transposed) const;
+
+            /**
+             * @brief Reads the comparison of a genome with itself of the previous state, thread safe.
+             * @param genome The hash of the genome.
+             * @param min The minimum of the genome in this run.
+             * @param edges Set to the edges.
+             * @return False if the genome is not in the previous state or its minimum was different.
+             */
+            inline bool findGenome(const hash_t genome, const score_t min, edges_t& edges) const;
+
+            /**
+             * @brief Adds a genome pair to the new state, thread safe.
+             * @param row The hash of the row genome.
+             * @param col The hash of the column genome.
+             * @param min The minimum BBH score of the pair.
+             * @param edges The edges of the pair.
+             */
+            inline void addPair(const hash_t row, const hash_t col, const score_t min, const edges_t& edges);
+
+            /**
+             * @brief Adds the comparison of a genome with itself to the new state, thread safe.
+             * @param genome The hash of the genome.
+             * @param min The minimum of the genome.
+             * @param edges The edges.
+             */
+            inline void addGenome(const hash_t genome, const score_t min, const edges_t& edges);
+
+            /**
+             * @brief Writes the new state and replaces the previous one.
+             */
+            inline void commit();
+    };
+
+    inline
+    RunState::RunState(const shared::kType k, const score_t discard)
+    : k_(k), discard_(discard), previousFd_(-1), previousGenomesNumber_(0), file_(nullptr) {}
+
+    inline
+    RunState::~RunState() {
+        if(previousFd_ >= 0)
+            close(previousFd_);
+        if(file_ != nullptr) {
+            std::fclose(file_);
+            std::remove(tmpPath_.c_str());
+        }
+    }
+
+    inline RunState::hash_t
+    RunState::hashGenome(genome::Genome& genome) {
+        hash_t hash = 14695981039346656037ULL;
+        auto& genes = genome.getGenes();
+        for(auto gene = genes.begin(); gene != genes.end(); ++gene) {
+            const std::string alphabet = gene->getAlphabet();
+            for(auto c = alphabet.begin(); c != alphabet.end(); ++c) {
+                hash ^= static_cast<unsigned char>(*c);
+                hash *= 1099511628211ULL;
+            }
+            // separatore tra i geni
+            hash ^= '\n';
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    inline void
+    RunState::read(void* data, const std::size_t size, const std::uint64_t offset) const {
+        char* bytes = static_cast<char*>(data);
+        std::size_t done = 0;
+        while(done < size) {
+            ssize_t n = pread(previousFd_, bytes + done, size - done, static_cast<off_t>(offset + done));
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n <= 0)
+                throw std::runtime_error("reading the previous run state: truncated file");
+            done += n;
+        }
+    }
+
+    inline void
+    RunState::readEdges(const Record& record, edges_t& edges) const {
+        edges.resize(record.edges);
+        if(record.edges > 0)
+            read(edges.data(), record.edges * sizeof(edge_t), record.offset);
+    }
+
+    inline void
+    RunState::load(const std::string& path) {
+        previousFd_ = open(path.c_str(), O_RDONLY);
+        if(previousFd_ < 0)
+            throw std::runtime_error("run state " + path + ": " + std::strerror(errno));
+
+        char magic[8];
+        std::uint64_t k, genomes;
+        score_t discard;
+        read(magic, sizeof(magic), 0);
+        if(std::memcmp(magic, "PDSTATE1", sizeof(magic)) != 0)
+            throw std::runtime_error("invalid run state " + path);
+        read(&k, sizeof(k), 8);
+        read(&discard, sizeof(discard), 16);
+        read(&genomes, sizeof(genomes), 24);
+        if(k != k_ || discard != discard_)
+            throw std::runtime_error("run state " + path + " computed with a different k or discard value");
+        previousGenomesNumber_ = genomes;
+
+        // dopo i genomi, i record fino alla fine del file
+        off_t end = lseek(previousFd_, 0, SEEK_END);
+        std::uint64_t offset = 32 + genomes * 2 * sizeof(std::uint64_t);
+        while(offset < static_cast<std::uint64_t>(end)) {
+            RecordHeader header;
+            read(&header, sizeof(header), offset);
+            offset += sizeof(header);
+
+            Record record{offset, header.edges, header.min};
+            if(header.type == pairRecord)
+                previousPairs_[key_t(header.row, header.col)] = record;
+            else
+                previousGenomes_[header.row] = record;
+            offset += header.edges * sizeof(edge_t);
+        }
+    }
+
+    inline void
+    RunState::create(const std::string& path, const hashes_t& hashes, const std::vector<index_t>& genes) {
+        path_ = path;
+        tmpPath_ = path + ".tmp";
+        file_ = std::fopen(tmpPath_.c_str(), "wb");
+        if(file_ == nullptr)
+            throw std::runtime_error("run state " + tmpPath_ + ": " + std::strerror(errno));
+
+        std::uint64_t genomes = hashes.size();
+        std::fwrite("PDSTATE1", 1, 8, file_);
+        std::fwrite(&k_, sizeof(k_), 1, file_);
+        std::fwrite(&discard_, sizeof(discard_), 1, file_);
+        std::fwrite(&genomes, sizeof(genomes), 1, file_);
+        for(index_t i = 0; i < hashes.size(); ++i) {
+            std::uint64_t size = genes[i];
+            std::fwrite(&hashes[i], sizeof(hash_t), 1, file_);
+            std::fwrite(&size, sizeof(size), 1, file_);
+        }
+    }
+
+    inline bool
+    RunState::hasPair(const hash_t row, const hash_t col) const {
+        return previousPairs_.count(key_t(row, col)) != 0 || previousPairs_.count(key_t(col, row)) != 0;
+    }
+
+    inline bool
+    RunState::findPair(const hash_t row, const hash_t col, score_t& min, edges_t& edges, bool& transposed) const {
+        auto record = previousPairs_.find(key_t(row, col));
+        transposed = false;
+        if(record == previousPairs_.end()) {
+            // coppia calcolata con i genomi in ordine inverso
+            record = previousPairs_.find(key_t(col, row));
+            transposed = true;
+            if(record == previousPairs_.end())
+                return false;
+        }
+        min = record->second.min;
+        readEdges(record->second, edges);
+        return true;
+    }
+
+    inline bool
+    RunState::findGenome(const hash_t genome, const score_t min, edges_t& edges) const {
+        auto record = previousGenomes_.find(genome);
+        if(record == previousGenomes_.end() || record->second.min != min)
+            return false;
+        readEdges(record->second, edges);
+        return true;
+    }
+
+    inline void
+    RunState::write(const std::uint64_t type, const hash_t row, const hash_t col, const score_t min, const edges_t& edges) {
+        RecordHeader header{type, row, col, min, edges.size()};
+        std::unique_lock<std::mutex> lock(mutex_);
+        std::fwrite(&header, sizeof(header), 1, file_);
+        if(!edges.empty())
+            std::fwrite(edges.data(), sizeof(edge_t), edges.size(), file_);
+    }
+
+    inline void
+    RunState::addPair(const hash_t row, const hash_t col, const score_t min, const edges_t& edges) {
+        write(pairRecord, row, col, min, edges);
+    }
+
+    inline void
+    RunState::addGenome(const hash_t genome, const score_t min, const edges_t& edges) {
+        write(genomeRecord, genome, genome, min, edges);
+    }
+
+    inline void
+    RunState::commit() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        bool failed = std::ferror(file_) != 0;
+        failed = std::fclose(file_) != 0 || failed;
+        file_ = nullptr;
+        if(failed)
+            throw std::runtime_error("writing run state " + tmpPath_);
+        // il precedente resta leggibile dal descrittore aperto fino alla distruzione
+        if(std::rename(tmpPath_.c_str(), path_.c_str()) != 0)
+            throw std::runtime_error("renaming run state " + tmpPath_ + ": " + std::strerror(errno));
+    }
+
+}
+
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef SCORE_CODEC_INCLUDE_GUARD
+#define SCORE_CODEC_INCLUDE_GUARD 1
+
+#include <cstdint>
+#include <limits>
+
+#include "VariablesTypes.hh"
+
+
+
+/**
+ * @file ScoreCodec.hh
+ * @brief Definitions for the ScoreCodec class.
+ */
+
+ /**
+  * @namespace score
+  * @brief Namespace containing definitions for score related classes.
+  */
+namespace score {
+
+    /**
+     * @class ScoreCodec
+     * @brief Converts the scores to the type stored by the score matrices and back.
+     *
+     * A score is num / den with 0 <= num <= den, so it lies in [0, 1]. Unless FULL_PRECISION_SCORES
+     * is defined it is stored as the 32 bit fixed point round(score * (2^32 - 1)), half the size of
+     * a double. Two different scores with den < 2^16 differ by at least 1 / (2^16 - 1)^2, more than
+     * one step of the fixed point: the encoding keeps their order and equal scores, and only equal
+     * scores, get equal codes. The ties of checkForBBH are then detected exactly by comparing codes.
+     * From den = 2^16 two different scores may get the same code (see isExact): Homology computes
+     * those pairs with the streaming engine, which keeps the scores as doubles, and FragHomology,
+     * whose scores are scaled by the fragment factor, checks the equal codes with the exact scores.
+     */
+    class ScoreCodec {
+    public:
+        using score_t = shared::scoreType;
+        using stored_t = shared::storedScoreType;
+        using multiplicity_t = shared::multiplicityType;
+
+        ScoreCodec() = delete;
+
+        /**
+         * @brief Converts a score to the stored type.
+         *
+         * @param score Score in [0, 1].
+         * @return The stored value, 0 only for a score of 0.
+         */
+        inline static stored_t encode(score_t score) noexcept;
+
+        /**
+         * @brief Converts a stored value back to a score, approximated to 2^-32 in fixed point.
+         *
+         * @param stored The stored value.
+         * @return The score.
+         */
+        inline static score_t decode(stored_t stored) noexcept;
+
+        /**
+         * @brief Checks if equal codes mean equal scores for the scores with a denominator up to den.
+         *
+         * @param den The largest denominator, at most the sum of the multiplicities of the two genes.
+         * @return True if the codes can be compared instead of the scores.
+         */
+        inline static bool isExact(multiplicity_t den) noexcept;
+    };
+
+#ifdef FULL_PRECISION_SCORES
+
+    inline ScoreCodec::stored_t
+        ScoreCodec::encode(score_t score) noexcept {
+        return score;
+    }
+
+    inline ScoreCodec::score_t
+        ScoreCodec::decode(stored_t stored) noexcept {
+        return stored;
+    }
+
+    inline bool
+        ScoreCodec::isExact(multiplicity_t) noexcept {
+        // i double sono gli stessi punteggi del motore streaming
+        return true;
+    }
+
+#else
+
+    inline ScoreCodec::stored_t
+        ScoreCodec::encode(score_t score) noexcept {
+        // arrotondamento al passo piu' vicino, 1 diventa il massimo del tipo
+        return static_cast<stored_t>(score * std::numeric_limits<stored_t>::max() + 0.5);
+    }
+
+    inline ScoreCodec::score_t
+        ScoreCodec::decode(stored_t stored) noexcept {
+        return static_cast<score_t>(stored) / std::numeric_limits<stored_t>::max();
+    }
+
+    inline bool
+        ScoreCodec::isExact(multiplicity_t den) noexcept {
+        // con den < 2^16 due punteggi diversi distano almeno 1 / (2^16 - 1)^2, piu' di un passo
+        return den < (static_cast<multiplicity_t>(1) << 16);
+    }
+
+#endif
+}
+#endif
@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "VariablesTypes.hh"
+#include "ScoreCodec.hh"
 
 
 
@@ -21,14 +22,24 @@ namespace score {
     /**
      * @class ScoresContainer
      * @brief Represents a container for storing scores associated with rows and columns.
+     *
+     * The scores are stored in a single allocation split in square blocks of blockSide * blockSide
+     * scores, one block after the other in row-major order. A row segment and a column segment of a
+     * block are both within a few pages, so the row writes of calculateRow and the column scans of
+     * checkForBBH miss the TLB once per block instead of once per row. Inside a block the scores are
+     * row-major, or column-major when the container is transposed: the column scans then read
+     * contiguous memory. A block side of 1 gives the plain row-major matrix.
+     *
+     * The scores are stored encoded by ScoreCodec: getScoreAt returns the stored value, to be
+     * compared with the encoding of other scores or decoded.
      */
     class ScoresContainer {
     private:
         using score_t = shared::scoreType;
+        using stored_t = shared::storedScoreType;
         using index_t = shared::indexType;
 
-        using cols_t = std::vector<score_t>;
-        using scores_t = std::vector<cols_t>;
+        using scores_t = std::vector<stored_t>;
 
         index_t rows_;
         index_t cols_;
@@ -36,10 +47,59 @@ namespace score {
         // dimensione massima effettiva [0, capacity)
         index_t capacity_;
 
-        // invece di allocare una matrice rows_*cols_ si crea un array dove tutte le righe
-        // sono una di seguito all'altra
+        // lato dei blocchi potenza di 2: gli indici si calcolano con shift e maschere
+        index_t blockShift_;
+        index_t blockMask_;
+        index_t blockSide_;
+        index_t blockSize_;
+        // numero di blocchi per riga di blocchi
+        index_t colBlocks_;
+        bool transposed_;
+
+        // invece di allocare una matrice rows_*cols_ si crea un array dove tutti i blocchi
+        // sono uno di seguito all'altro
         scores_t scores_;
+
+        /**
+         * @brief Position of a score in the array.
+         *
+         * @param rowNumber Row index.
+         * @param colNumber Column index.
+         * @return The offset of the score.
+         */
+        inline index_t offset(index_t rowNumber, index_t colNumber) const noexcept;
+
     public:
+        /**
+         * @brief Side of the blocks used when none is given: 32 * 32 scores, 4 KiB (8 KiB in full precision).
+         */
+        static constexpr index_t defaultBlockSide = 32;
+
+        /**
+         * @class TransposedView
+         * @brief Reads a ScoresContainer with rows and columns swapped, without copying it.
+         */
+        class TransposedView {
+        private:
+            const ScoresContainer& scores_;
+
+        public:
+            /**
+             * @brief Constructs a view of scores.
+             *
+             * @param scores The viewed container, it must outlive the view.
+             */
+            inline explicit TransposedView(const ScoresContainer& scores) noexcept;
+
+            /**
+             * @brief Retrieves the score at the specified column and row of the viewed container.
+             *
+             * @param colNumber Column index of the viewed container.
+             * @param rowNumber Row index of the viewed container.
+             * @return Stored score at rowNumber, colNumber of the viewed container.
+             */
+            inline stored_t getScoreAt(index_t colNumber, index_t rowNumber) const noexcept;
+        };
 
         /**
          * @brief Deleted default constructor to prevent instantiation without parameters.
@@ -51,8 +111,10 @@ namespace score {
          *
          * @param rowsNumber Number of rows.
          * @param colsNumber Number of columns.
+         * @param blockSide Side of the square blocks, rounded up to a power of 2 (0 is treated as 1).
+         * @param transposed True to store the scores of a block column-major.
          */
-        inline explicit ScoresContainer(index_t rowsNumber, index_t colsNumber) noexcept;
+        inline explicit ScoresContainer(index_t rowsNumber, index_t colsNumber, index_t blockSide = defaultBlockSide, bool transposed = false);
 
         ScoresContainer(const ScoresContainer& other) = delete;
         ScoresContainer(const ScoresContainer&& other) = delete;
@@ -61,12 +123,21 @@ namespace score {
 
 
 
+        /**
+         * @brief Resizes the container with every score set to 0, keeping the block side and the
+         *        orientation; the allocation is reused when it is large enough.
+         *
+         * @param rowsNumber Number of rows.
+         * @param colsNumber Number of columns.
+         */
+        inline void reset(index_t rowsNumber, index_t colsNumber);
+
         /**
          * @brief Sets the score at the specified row and column.
          *
          * @param rowNumber Row index.
          * @param colNumber Column index.
-         * @param newScore New score to set.
+         * @param newScore New score to set, encoded by ScoreCodec.
          */
         inline void setScoreAt(index_t rowNumber, index_t colNumber, score_t newScore) noexcept;
 
@@ -75,9 +146,16 @@ namespace score {
          *
          * @param rowNumber Row index.
          * @param colNumber Column index.
-         * @return Score at the specified row and column.
+         * @return Stored score at the specified row and column.
          */
-        inline score_t getScoreAt(index_t rowNumber, index_t colNumber) noexcept;
+        inline stored_t getScoreAt(index_t rowNumber, index_t colNumber) const noexcept;
+
+        /**
+         * @brief Retrieves a view with rows and columns swapped.
+         *
+         * @return The transposed view.
+         */
+        inline TransposedView getTransposedView() const noexcept;
 
         /**
          * @brief Retrieves the capacity of the container.
@@ -94,36 +172,61 @@ namespace score {
 
 
     inline
-        ScoresContainer::ScoresContainer(index_t rowsNumber, index_t colsNumber) noexcept
-        : rows_(rowsNumber), cols_(colsNumber), capacity_(cols_* rows_) {
-        scores_.reserve(rowsNumber);
-
-        for (index_t i = 0; i < rowsNumber; ++i) {
-            cols_t cols;
-            cols.reserve(colsNumber);
-            for (index_t j = 0; j < colsNumber; ++j) {
-                cols.emplace_back(
-                    0
-                );
-            }
-            scores_.emplace_back(
-                std::move(
-                    std::move(
-                        cols
-                    )
-                )
-            );
-        }
-    };
+        ScoresContainer::ScoresContainer(index_t rowsNumber, index_t colsNumber, index_t blockSide, bool transposed)
+        : rows_(rowsNumber), cols_(colsNumber), capacity_(cols_* rows_), blockShift_(0), transposed_(transposed) {
+        while ((index_t(1) << blockShift_) < blockSide)
+            ++blockShift_;
+        blockSide_ = index_t(1) << blockShift_;
+        blockMask_ = blockSide_ - 1;
+        blockSize_ = blockSide_ * blockSide_;
+        colBlocks_ = (colsNumber + blockSide_ - 1) >> blockShift_;
+
+        // righe e colonne arrotondate a blocchi interi, un'unica allocazione azzerata
+        index_t rowBlocks = (rowsNumber + blockSide_ - 1) >> blockShift_;
+        scores_.assign(rowBlocks * colBlocks_ * blockSize_, 0);
+    }
+
+    inline void
+        ScoresContainer::reset(index_t rowsNumber, index_t colsNumber) {
+        rows_ = rowsNumber;
+        cols_ = colsNumber;
+        capacity_ = rows_ * cols_;
+        colBlocks_ = (colsNumber + blockSide_ - 1) >> blockShift_;
+        index_t rowBlocks = (rowsNumber + blockSide_ - 1) >> blockShift_;
+        // assign non rialloca se la capacita' basta, le pagine restano gia' mappate
+        scores_.assign(rowBlocks * colBlocks_ * blockSize_, 0);
+    }
+
+    inline ScoresContainer::index_t
+        ScoresContainer::offset(index_t rowNumber, index_t colNumber) const noexcept {
+        index_t innerRow = rowNumber & blockMask_;
+        index_t innerCol = colNumber & blockMask_;
+        index_t inner = transposed_ ? (innerCol << blockShift_) + innerRow : (innerRow << blockShift_) + innerCol;
+        return (((rowNumber >> blockShift_) * colBlocks_ + (colNumber >> blockShift_)) << (2 * blockShift_)) + inner;
+    }
 
     inline void
         ScoresContainer::setScoreAt(index_t rowNumber, index_t colNumber, score_t newScore) noexcept {
-        scores_[rowNumber][colNumber] = newScore;
+        scores_[offset(rowNumber, colNumber)] = ScoreCodec::encode(newScore);
+    }
+
+    inline ScoresContainer::stored_t
+        ScoresContainer::getScoreAt(index_t rowNumber, index_t colNumber) const noexcept {
+        return scores_[offset(rowNumber, colNumber)];
+    }
+
+    inline
+        ScoresContainer::TransposedView::TransposedView(const ScoresContainer& scores) noexcept
+        : scores_(scores) {}
+
+    inline ScoresContainer::stored_t
+        ScoresContainer::TransposedView::getScoreAt(index_t colNumber, index_t rowNumber) const noexcept {
+        return scores_.getScoreAt(rowNumber, colNumber);
     }
 
-    inline ScoresContainer::score_t
-        ScoresContainer::getScoreAt(index_t rowNumber, index_t colNumber) noexcept {
-        return scores_[rowNumber][colNumber];
+    inline ScoresContainer::TransposedView
+        ScoresContainer::getTransposedView() const noexcept {
+        return TransposedView(*this);
     }
 
     inline ScoresContainer::index_t
@@ -131,4 +234,4 @@ namespace score {
         return capacity_;
     }
 }
-#endif
\ No newline at end of file
+#endif
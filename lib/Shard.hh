@@ -0,0 +1,297 @@
+#ifndef SHARD_INCLUDE_GUARD
+#define SHARD_INCLUDE_GUARD 1
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "VariablesTypes.hh"
+
+
+/**
+ * @file Shard.hh
+ * @brief Definitions for the Shard class.
+ */
+
+/**
+ * @namespace homology
+ * @brief Namespace containing definitions for homology computation related classes.
+ */
+
+namespace homology {
+
+    /**
+     * @class Shard
+     * @brief The genome pairs computed by one of the processes sharing a run.
+     *
+     * Every process builds the same list of pairs of different genomes, in decreasing order of cost
+     * (genes of the row genome * genes of the column genome), and splits it in the same way:
+     * - static: the pairs are assigned to count shards, each one to the least loaded shard so far
+     *   (longest processing time first), and the process computes those of its shard;
+     * - dynamic: the pairs are cut into batches of similar cost and the process computes every batch
+     *   it claims by creating its lock file in a directory shared by the processes.
+     * In both cases the pairs of a process are computed by batches, so that only the kmers of the genomes
+     * of a batch need to be in memory together.
+     * The minimum BBH score of every computed pair is saved next to the output of the process, the
+     * merge (see loadMins) reduces them and runs the comparisons of the genomes with themselves.
+     */
+    class Shard {
+        public:
+            using index_t = shared::indexType;
+            using score_t = shared::scoreType;
+            using cost_t = std::size_t;
+
+            /**
+             * @brief A pair of different genomes, row < col.
+             */
+            struct Pair {
+                index_t row;
+                index_t col;
+                cost_t cost;
+            };
+
+            using pairs_t = std::vector<Pair>;
+            using batch_t = std::pair<index_t, index_t>;
+
+        private:
+            using batches_t = std::vector<batch_t>;
+
+            // lotti per esecuzione: abbastanza da bilanciare molti processi, pochi file di lock
+            static constexpr index_t batchesNumber = 1024;
+
+            index_t genomesNumber_;
+            std::string directory_;
+            pairs_t pairs_;
+            batches_t batches_;
+            // lotti calcolati da questo processo
+            std::vector<index_t> claimed_;
+
+            /**
+             * @brief Cuts the pairs into consecutive batches of similar cost.
+             */
+            inline void cutBatches();
+
+        public:
+            /**
+             * @brief Builds the pairs of a static shard.
+             * @param genes The number of genes of every genome.
+             * @param index The index of the shard, from 0 to count - 1.
+             * @param count The number of shards.
+             */
+            inline explicit Shard(const std::vector<index_t>& genes, const index_t index, const index_t count);
+
+            /**
+             * @brief Builds the batches of a dynamic shard.
+             * @param genes The number of genes of every genome.
+             * @param directory The directory of the lock files, shared by the processes and empty at the start of the run.
+             */
+            inline explicit Shard(const std::vector<index_t>& genes, const std::string& directory);
+
+            Shard(const Shard&) = delete;
+            Shard& operator=(const Shard&) = delete;
+            Shard(Shard&&) = delete;
+            Shard& operator=(Shard&&) = delete;
+
+            /**
+             * @brief Default destructor.
+             */
+            ~Shard() = default;
+
+            /**
+             * @brief Gets the pairs, those of the batches are contiguous.
+             * @return The pairs.
+             */
+            inline const pairs_t& getPairs() const noexcept {
+                return pairs_;
+            }
+
+            /**
+             * @brief Gets the number of batches.
+             * @return The number of batches.
+             */
+            inline index_t getBatchesNumber() const noexcept {
+                return batches_.size();
+            }
+
+            /**
+             * @brief Gets a batch.
+             * @param batch The index of the batch.
+             * @return The positions of its first and past the last pair in getPairs.
+             */
+            inline batch_t getBatch(const index_t batch) const {
+                return batches_[batch];
+            }
+
+            /**
+             * @brief Claims a batch: always granted in a static shard, granted to a single process in a dynamic one.
+             * @param batch The index of the batch.
+             * @return True if the batch must be computed by this process.
+             */
+            inline bool claim(const index_t batch);
+
+            /**
+             * @brief Saves the minimum BBH score of the pairs of the claimed batches.
+             * @tparam F Function returning the minimum of a pair: score_t(row, col).
+             * @param path The file of the minimums.
+             * @param getMin The function.
+             */
+            template<typename F>
+            inline void saveMins(const std::string& path, F getMin) const;
+
+            /**
+             * @brief Loads the minimums saved by a process.
+             * @tparam F Function receiving the minimum of a pair: void(row, col, min).
+             * @param path The file of the minimums.
+             * @param genomesNumber The number of genomes of the run.
+             * @param setMin The function.
+             * @return The number of pairs loaded.
+             */
+            template<typename F>
+            inline static std::size_t loadMins(const std::string& path, const index_t genomesNumber, F setMin);
+    };
+
+    inline
+    Shard::Shard(const std::vector<index_t>& genes, const index_t index, const index_t count)
+    : genomesNumber_(genes.size()) {
+        if(count == 0 || index >= count)
+            throw std::runtime_error("invalid shard " + std::to_string(index) + "/" + std::to_string(count));
+
+        pairs_t all;
+        for(index_t row = 0; row < genes.size(); ++row)
+            for(index_t col = row + 1; col < genes.size(); ++col)
+                all.push_back(Pair{row, col, static_cast<cost_t>(genes[row]) * genes[col]});
+        // ordine totale: la stessa suddivisione in ogni processo
+        std::sort(
+            all.begin(), all.end(),
+            [](const Pair& a, const Pair& b) {
+                return a.cost != b.cost ? a.cost > b.cost : (a.row != b.row ? a.row < b.row : a.col < b.col);
+            }
+        );
+
+        // ogni coppia al shard meno carico, a parita' quello con indice minore
+        std::vector<cost_t> loads(count, 0);
+        for(auto pair = all.begin(); pair != all.end(); ++pair) {
+            index_t shard = std::min_element(loads.begin(), loads.end()) - loads.begin();
+            loads[shard] += pair->cost;
+            if(shard == index)
+                pairs_.push_back(*pair);
+        }
+
+        cutBatches();
+    }
+
+    inline
+    Shard::Shard(const std::vector<index_t>& genes, const std::string& directory)
+    : genomesNumber_(genes.size()), directory_(directory) {
+        for(index_t row = 0; row < genes.size(); ++row)
+            for(index_t col = row + 1; col < genes.size(); ++col)
+                pairs_.push_back(Pair{row, col, static_cast<cost_t>(genes[row]) * genes[col]});
+        std::sort(
+            pairs_.begin(), pairs_.end(),
+            [](const Pair& a, const Pair& b) {
+                return a.cost != b.cost ? a.cost > b.cost : (a.row != b.row ? a.row < b.row : a.col < b.col);
+            }
+        );
+
+        cutBatches();
+    }
+
+    inline void
+    Shard::cutBatches() {
+        cost_t total = 0;
+        for(auto pair = pairs_.begin(); pair != pairs_.end(); ++pair)
+            total += pair->cost;
+
+        // lotti consecutivi di costo simile: i primi hanno poche coppie costose, gli ultimi molte economiche
+        cost_t batchCost = total / batchesNumber + 1;
+        index_t first = 0;
+        cost_t cost = 0;
+        for(index_t i = 0; i < pairs_.size(); ++i) {
+            cost += pairs_[i].cost;
+            if(cost >= batchCost || i + 1 == pairs_.size()) {
+                batches_.push_back(batch_t(first, i + 1));
+                first = i + 1;
+                cost = 0;
+            }
+        }
+    }
+
+    inline bool
+    Shard::claim(const index_t batch) {
+        if(!directory_.empty()) {
+            // O_EXCL: un solo processo crea il file di lock, anche su file system condivisi
+            std::string path = directory_ + "/batch-" + std::to_string(batch) + ".lock";
+            int fd = open(path.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+            if(fd < 0) {
+                if(errno == EEXIST)
+                    return false;
+                throw std::runtime_error("claiming " + path + ": " + std::strerror(errno));
+            }
+            char host[256] = "";
+            gethostname(host, sizeof(host) - 1);
+            std::string owner = std::string(host) + " " + std::to_string(getpid()) + "\n";
+            ssize_t written = write(fd, owner.data(), owner.size());
+            (void) written;
+            close(fd);
+        }
+        claimed_.push_back(batch);
+        return true;
+    }
+
+    template<typename F>
+    inline void
+    Shard::saveMins(const std::string& path, F getMin) const {
+        std::ofstream file(path, std::ios::out | std::ios::trunc);
+        file<<"pandelos-shard 1\ngenomes "<<genomesNumber_<<"\n";
+        // i minimi sono in esadecimale: riletti identici
+        char min[64];
+        for(auto batch = claimed_.begin(); batch != claimed_.end(); ++batch)
+            for(index_t i = batches_[*batch].first; i < batches_[*batch].second; ++i) {
+                std::snprintf(min, sizeof(min), "%a", getMin(pairs_[i].row, pairs_[i].col));
+                file<<"pair "<<pairs_[i].row<<" "<<pairs_[i].col<<" "<<min<<"\n";
+            }
+        file.flush();
+        if(!file.good())
+            throw std::runtime_error("writing shard minimums " + path);
+    }
+
+    template<typename F>
+    inline std::size_t
+    Shard::loadMins(const std::string& path, const index_t genomesNumber, F setMin) {
+        std::ifstream file(path);
+        if(!file.is_open())
+            throw std::runtime_error("missing shard minimums " + path);
+
+        std::string line, key;
+        index_t genomes = 0;
+        if(!std::getline(file, line) || line != "pandelos-shard 1" || !(file >> key >> genomes) || key != "genomes")
+            throw std::runtime_error("invalid shard minimums " + path);
+        if(genomes != genomesNumber)
+            throw std::runtime_error("shard minimums " + path + " of a run with " + std::to_string(genomes) + " genomes");
+
+        std::size_t pairs = 0;
+        index_t row, col;
+        std::string min;
+        while(file >> key >> row >> col >> min) {
+            if(key != "pair" || row >= col || col >= genomesNumber)
+                throw std::runtime_error("invalid shard minimums " + path);
+            setMin(row, col, std::strtod(min.c_str(), nullptr));
+            ++pairs;
+        }
+        return pairs;
+    }
+
+}
+
+
+#endif
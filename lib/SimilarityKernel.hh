@@ -0,0 +1,84 @@
+#ifndef SIMILARITY_KERNEL_INCLUDE_GUARD
+#define SIMILARITY_KERNEL_INCLUDE_GUARD 1
+
+#include <string>
+
+
+/**
+ * @file SimilarityKernel.hh
+ * @brief Definitions of the kernels that compute the similarity of two kmer profiles.
+ */
+
+/**
+ * @namespace homology
+ * @brief Namespace containing definitions for homology computation related classes.
+ */
+
+namespace homology {
+
+    /**
+     * @brief The strategies used by Homology to compute the Generalized Jaccard index of two genes.
+     *
+     * - merge: two-way merge of the sorted kmer dictionaries of the two genes
+     * - galloping: the dictionary with fewer kmers is walked, the other one is searched with
+     *   exponential + binary search, fast when the sizes are very different
+     * - scatterGather: the row gene is scattered once in a dense array indexed by kmer id,
+     *   then every column gene reads its kmers from the array
+     * - invertedIndex: the column genome is indexed by kmer, every row gene walks the postings
+     *   of its kmers and accumulates the intersection with all the column genes at once
+     * - automatic: the kernel is chosen for every genome pair by timing the others on a sample
+     */
+    enum class SimilarityKernel {
+        merge,
+        galloping,
+        scatterGather,
+        invertedIndex,
+        automatic
+    };
+
+    /**
+     * @brief Converts a kernel name given on the command line.
+     * @param name "merge", "galloping", "scatter", "inverted" or "auto".
+     * @param kernel Set to the kernel with that name.
+     * @return False if the name is unknown, in this case kernel is unchanged.
+     */
+    inline bool parseSimilarityKernel(const std::string& name, SimilarityKernel& kernel) {
+        if(name == "merge")
+            kernel = SimilarityKernel::merge;
+        else if(name == "galloping")
+            kernel = SimilarityKernel::galloping;
+        else if(name == "scatter")
+            kernel = SimilarityKernel::scatterGather;
+        else if(name == "inverted")
+            kernel = SimilarityKernel::invertedIndex;
+        else if(name == "auto")
+            kernel = SimilarityKernel::automatic;
+        else
+            return false;
+        return true;
+    }
+
+    /**
+     * @brief Retrieves the name of a kernel, the same accepted by parseSimilarityKernel.
+     * @param kernel The kernel.
+     * @return The name of the kernel.
+     */
+    inline std::string getSimilarityKernelName(const SimilarityKernel kernel) {
+        switch(kernel) {
+            case SimilarityKernel::galloping:
+                return "galloping";
+            case SimilarityKernel::scatterGather:
+                return "scatter";
+            case SimilarityKernel::invertedIndex:
+                return "inverted";
+            case SimilarityKernel::automatic:
+                return "auto";
+            case SimilarityKernel::merge:
+            default:
+                return "merge";
+        }
+    }
+
+}
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef SPARSE_SCORES_CONTAINER_INCLUDE_GUARD
+#define SPARSE_SCORES_CONTAINER_INCLUDE_GUARD 1
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "VariablesTypes.hh"
+#include "ScoreCodec.hh"
+
+
+
+/**
+ * @file SparseScoresContainer.hh
+ * @brief Definitions for the SparseScoresContainer class.
+ */
+
+ /**
+  * @namespace score
+  * @brief Namespace containing definitions for score related classes.
+  */
+namespace score {
+
+    /**
+     * @class SparseScoresContainer
+     * @brief Stores only the nonzero scores of a genome pair, compressed by column (CSC).
+     *
+     * While the pair is computed every task appends its (row, col, score) triples to a local buffer
+     * and hands it over with appendScores. compress merges the buffers with a counting sort by column:
+     * afterwards the scores of a column are contiguous and sorted by row, and the memory is
+     * proportional to the nonzero scores instead of rows * cols. The scores are stored encoded by
+     * ScoreCodec, a compressed entry takes 8 bytes.
+     */
+    class SparseScoresContainer {
+    public:
+        using stored_t = shared::storedScoreType;
+        using index_t = shared::indexType;
+
+        /**
+         * @brief A nonzero score appended by a task.
+         */
+        struct Triple {
+            std::uint32_t row;
+            std::uint32_t col;
+            stored_t score;
+        };
+
+        /**
+         * @brief A nonzero score of a compressed column.
+         */
+        struct Entry {
+            std::uint32_t row;
+            stored_t score;
+        };
+
+        using buffer_t = std::vector<Triple>;
+
+    private:
+        using buffers_t = std::vector<buffer_t>;
+        using offsets_t = std::vector<std::uint32_t>;
+        using entries_t = std::vector<Entry>;
+
+        index_t rows_;
+        index_t cols_;
+
+        // buffer consegnati dai task, svuotati da compress
+        buffers_t buffers_;
+        std::mutex buffersMutex_;
+
+        // le entry della colonna col sono in [offsets_[col], offsets_[col + 1])
+        offsets_t offsets_;
+        entries_t entries_;
+
+    public:
+
+        /**
+         * @brief Deleted default constructor to prevent instantiation without parameters.
+         */
+        SparseScoresContainer() = delete;
+
+        /**
+         * @brief Constructs an empty SparseScoresContainer with the specified number of rows and columns.
+         *
+         * @param rowsNumber Number of rows.
+         * @param colsNumber Number of columns.
+         */
+        inline explicit SparseScoresContainer(index_t rowsNumber, index_t colsNumber) noexcept;
+
+        SparseScoresContainer(const SparseScoresContainer& other) = delete;
+        SparseScoresContainer(const SparseScoresContainer&& other) = delete;
+        SparseScoresContainer& operator=(const SparseScoresContainer& other) = delete;
+        SparseScoresContainer& operator=(const SparseScoresContainer&& other) = delete;
+
+        /**
+         * @brief Empties the container and sets its size, the memory of the compressed columns is kept.
+         *
+         * @param rowsNumber Number of rows.
+         * @param colsNumber Number of columns.
+         */
+        inline void reset(index_t rowsNumber, index_t colsNumber);
+
+        /**
+         * @brief Hands over the nonzero scores collected by a task, thread safe.
+         *
+         * @param buffer The triples, left empty.
+         */
+        inline void appendScores(buffer_t& buffer);
+
+        /**
+         * @brief Merges the appended buffers into the columns, to be called once all the tasks are completed.
+         */
+        inline void compress();
+
+        /**
+         * @brief Retrieves the first score of a column, after compress.
+         *
+         * @param colNumber Column index.
+         * @return Pointer to the first entry, sorted by row.
+         */
+        inline const Entry* getColumnBegin(index_t colNumber) const noexcept;
+
+        /**
+         * @brief Retrieves the end of the scores of a column, after compress.
+         *
+         * @param colNumber Column index.
+         * @return Pointer past the last entry.
+         */
+        inline const Entry* getColumnEnd(index_t colNumber) const noexcept;
+
+        /**
+         * @brief Retrieves the number of stored scores, after compress.
+         *
+         * @return Number of nonzero scores.
+         */
+        inline index_t getNonZeros() const noexcept;
+
+        /**
+         * @brief Default destructor.
+         */
+        inline ~SparseScoresContainer() = default;
+    };
+
+
+    inline
+        SparseScoresContainer::SparseScoresContainer(index_t rowsNumber, index_t colsNumber) noexcept
+        : rows_(rowsNumber), cols_(colsNumber) {}
+
+    inline void
+        SparseScoresContainer::reset(index_t rowsNumber, index_t colsNumber) {
+        rows_ = rowsNumber;
+        cols_ = colsNumber;
+        buffers_.clear();
+        offsets_.clear();
+        entries_.clear();
+    }
+
+    inline void
+        SparseScoresContainer::appendScores(buffer_t& buffer) {
+        if (buffer.empty())
+            return;
+
+        buffer_t moved;
+        moved.swap(buffer);
+
+        std::unique_lock<std::mutex> lock(buffersMutex_);
+        buffers_.emplace_back(std::move(moved));
+    }
+
+    inline void
+        SparseScoresContainer::compress() {
+        offsets_.assign(cols_ + 1, 0);
+
+        // conteggio per colonna, poi somma prefissa
+        for (auto buffer = buffers_.begin(); buffer != buffers_.end(); ++buffer)
+            for (auto triple = buffer->begin(); triple != buffer->end(); ++triple)
+                ++offsets_[triple->col + 1];
+        for (index_t col = 0; col < cols_; ++col)
+            offsets_[col + 1] += offsets_[col];
+
+        entries_.resize(offsets_[cols_]);
+
+        offsets_t next(offsets_.begin(), offsets_.end() - 1);
+        for (auto buffer = buffers_.begin(); buffer != buffers_.end(); ++buffer) {
+            for (auto triple = buffer->begin(); triple != buffer->end(); ++triple) {
+                Entry& entry = entries_[next[triple->col]++];
+                entry.row = triple->row;
+                entry.score = triple->score;
+            }
+            // libera subito il buffer, il picco resta vicino a una copia dei non nulli
+            buffer_t().swap(*buffer);
+        }
+        buffers_t().swap(buffers_);
+
+        // i task consegnano in ordine qualsiasi, le righe di ogni colonna vengono ordinate
+        for (index_t col = 0; col < cols_; ++col) {
+            std::sort(
+                entries_.begin() + offsets_[col], entries_.begin() + offsets_[col + 1],
+                [](const Entry& a, const Entry& b) { return a.row < b.row; }
+            );
+        }
+    }
+
+    inline const SparseScoresContainer::Entry*
+        SparseScoresContainer::getColumnBegin(index_t colNumber) const noexcept {
+        return entries_.data() + offsets_[colNumber];
+    }
+
+    inline const SparseScoresContainer::Entry*
+        SparseScoresContainer::getColumnEnd(index_t colNumber) const noexcept {
+        return entries_.data() + offsets_[colNumber + 1];
+    }
+
+    inline SparseScoresContainer::index_t
+        SparseScoresContainer::getNonZeros() const noexcept {
+        return entries_.size();
+    }
+}
+#endif
@@ -0,0 +1,159 @@
+#ifndef TRIANGULAR_SCORES_CONTAINER_INCLUDE_GUARD
+#define TRIANGULAR_SCORES_CONTAINER_INCLUDE_GUARD 1
+
+#include <vector>
+
+#include "VariablesTypes.hh"
+#include "ScoreCodec.hh"
+
+
+
+/**
+ * @file TriangularScoresContainer.hh
+ * @brief Definitions for the TriangularScoresContainer class.
+ */
+
+ /**
+  * @namespace score
+  * @brief Namespace containing definitions for score related classes.
+  */
+namespace score {
+
+    /**
+     * @class TriangularScoresContainer
+     * @brief Stores the scores of a genome with itself, only for the pairs row < col.
+     *
+     * The strict upper triangle is packed in a single array, n * (n - 1) / 2 scores instead of n * n.
+     * The packing is row-major on the transposed triangle: the rows 0 .. col - 1 of a column are
+     * contiguous, starting at col * (col - 1) / 2, so the column scans of checkForBBHSame read
+     * consecutive memory. The scores are stored encoded by ScoreCodec.
+     */
+    class TriangularScoresContainer {
+    private:
+        using score_t = shared::scoreType;
+        using stored_t = shared::storedScoreType;
+        using index_t = shared::indexType;
+
+        using scores_t = std::vector<stored_t>;
+
+        index_t genes_;
+
+        // dimensione massima effettiva [0, capacity)
+        index_t capacity_;
+
+        scores_t scores_;
+
+        /**
+         * @brief Position of the pair in the packed array.
+         *
+         * @param rowNumber Row index, lower than colNumber.
+         * @param colNumber Column index.
+         * @return The offset of the score.
+         */
+        inline static index_t offset(index_t rowNumber, index_t colNumber) noexcept;
+
+    public:
+
+        /**
+         * @brief Deleted default constructor to prevent instantiation without parameters.
+         */
+        TriangularScoresContainer() = delete;
+
+        /**
+         * @brief Constructs a TriangularScoresContainer for a genome with the specified number of genes.
+         *
+         * @param genesNumber Number of genes, both rows and columns.
+         */
+        inline explicit TriangularScoresContainer(index_t genesNumber);
+
+        TriangularScoresContainer(const TriangularScoresContainer& other) = delete;
+        TriangularScoresContainer(const TriangularScoresContainer&& other) = delete;
+        TriangularScoresContainer& operator=(const TriangularScoresContainer& other) = delete;
+        TriangularScoresContainer& operator=(const TriangularScoresContainer&& other) = delete;
+
+        /**
+         * @brief Resizes the container to genesNumber genes with every score set to 0, the allocation is reused.
+         *
+         * @param genesNumber Number of genes, both rows and columns.
+         */
+        inline void reset(index_t genesNumber);
+
+        /**
+         * @brief Sets the score at the specified row and column.
+         *
+         * @param rowNumber Row index, lower than colNumber.
+         * @param colNumber Column index.
+         * @param newScore New score to set, encoded by ScoreCodec.
+         */
+        inline void setScoreAt(index_t rowNumber, index_t colNumber, score_t newScore) noexcept;
+
+        /**
+         * @brief Retrieves the score at the specified row and column.
+         *
+         * @param rowNumber Row index, lower than colNumber.
+         * @param colNumber Column index.
+         * @return Stored score at the specified row and column.
+         */
+        inline stored_t getScoreAt(index_t rowNumber, index_t colNumber) const noexcept;
+
+        /**
+         * @brief Retrieves the scores of the rows 0 .. colNumber - 1 of a column.
+         *
+         * @param colNumber Column index.
+         * @return Pointer to the stored score of row 0, the following rows are contiguous.
+         */
+        inline const stored_t* getColumn(index_t colNumber) const noexcept;
+
+        /**
+         * @brief Retrieves the capacity of the container.
+         *
+         * @return Capacity of the container.
+         */
+        inline index_t getCapacity() const noexcept;
+
+        /**
+         * @brief Default destructor.
+         */
+        inline ~TriangularScoresContainer() = default;
+    };
+
+
+    inline
+        TriangularScoresContainer::TriangularScoresContainer(index_t genesNumber)
+        : genes_(genesNumber), capacity_(genesNumber * (genesNumber - (genesNumber > 0 ? 1 : 0)) / 2), scores_(capacity_, 0) {}
+
+    inline void
+        TriangularScoresContainer::reset(index_t genesNumber) {
+        genes_ = genesNumber;
+        capacity_ = genesNumber * (genesNumber - (genesNumber > 0 ? 1 : 0)) / 2;
+        // assign non rialloca se la capacita' basta
+        scores_.assign(capacity_, 0);
+    }
+
+    inline TriangularScoresContainer::index_t
+        TriangularScoresContainer::offset(index_t rowNumber, index_t colNumber) noexcept {
+        return colNumber * (colNumber - 1) / 2 + rowNumber;
+    }
+
+    inline void
+        TriangularScoresContainer::setScoreAt(index_t rowNumber, index_t colNumber, score_t newScore) noexcept {
+        scores_[offset(rowNumber, colNumber)] = ScoreCodec::encode(newScore);
+    }
+
+    inline TriangularScoresContainer::stored_t
+        TriangularScoresContainer::getScoreAt(index_t rowNumber, index_t colNumber) const noexcept {
+        return scores_[offset(rowNumber, colNumber)];
+    }
+
+    inline const TriangularScoresContainer::stored_t*
+        TriangularScoresContainer::getColumn(index_t colNumber) const noexcept {
+        // la colonna 0 non ha righe precedenti, non viene letta
+        return scores_.data() + (colNumber == 0 ? 0 : offset(0, colNumber));
+    }
+
+    inline TriangularScoresContainer::index_t
+        TriangularScoresContainer::getCapacity() const noexcept {
+        return capacity_;
+    }
+}
+#endif
@@ -12,6 +12,14 @@
  */
 // #define DEV_MODE 1
 
+/**
+ * @brief Macro to store the score matrices in double precision.
+ *
+ * When set to 1, the score matrices store doubles instead of 32 bit fixed point scores
+ * (see score::ScoreCodec), doubling their memory.
+ */
+// #define FULL_PRECISION_SCORES 1
+
 
 /**
  * @brief Namespace containing shared variable types.
@@ -47,6 +55,15 @@ namespace shared {
      */
     using scoreType = double;
 
+    /**
+     * @brief Type alias for the scores stored in the score matrices.
+     */
+#ifdef FULL_PRECISION_SCORES
+    using storedScoreType = double;
+#else
+    using storedScoreType = std::uint32_t;
+#endif
+
     /**
      * @brief Constant indicating a cut value.
      *
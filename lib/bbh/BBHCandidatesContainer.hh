@@ -2,17 +2,17 @@
 #define BBH_CANDIDATES_CONTAINER_INCLUDE_GUARD 1
 
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <utility>
 #include <iostream>
 #include <mutex>
 #include <atomic>
 #include <vector>
-#include <unordered_set>
-#include <ext/pb_ds/assoc_container.hpp>
-#include <ext/pb_ds/hash_policy.hpp>
+#include <algorithm>
 #include "../VariablesTypes.hh"
-#include "BBHCandidate.hh"
 #include "../../threads/ThreadPool.hh"
+#include "../../threads/TaskGroup.hh"
 
 
 
@@ -30,50 +30,69 @@ namespace bbh{
 
     /**
      * @class BBHCandidatesContainer
-     * @brief Represents a container for managing sets of BBHCandidates.
+     * @brief Represents a container for managing, for every index, the best score and the candidates that reach it.
+     *
+     * The storage is flat: one best score and one inline candidate per index, which is all the common
+     * single-best case needs, while further tied candidates are chained in an arena shared by all the
+     * indexes. A better score resets the index without touching the arena, so no per-index list is
+     * allocated or reserved.
+     *
+     * Every index is stamped with the epoch of its last update: reset starts a new epoch, so a container
+     * can be reused for the next genome pair without clearing its arrays, the indexes with an old stamp
+     * are read as empty and cleared by their first addCandidate.
      */
     class BBHCandidatesContainer {
         private:
 
             using index_t = shared::indexType;
             using score_t = shared::scoreType;
+            using position_t = std::uint32_t;
+
+            // candidato pari merito: colonna e prossimo nodo della catena
+            struct TieNode {
+                position_t candidate;
+                position_t next;
+            };
+
+            using scores_t = std::vector<score_t>;
+            using positions_t = std::vector<position_t>;
+            using arena_t = std::vector<TieNode>;
+
+            using epoch_t = std::uint32_t;
+            using epochs_t = std::vector<epoch_t>;
+
+            static constexpr position_t none_ = std::numeric_limits<position_t>::max();
 
-            using BBHCandidate_t = bbh::BBHCandidate;
-            using BBHCandidate_tp = BBHCandidate_t*;
-            using BBHCandidatesSet = std::unordered_set<index_t>;
-            
-            using candidates_t = std::vector<BBHCandidate_t>;
-            
             index_t capacity_;
-            candidates_t candidates_;
-            using set_t = __gnu_pbds::gp_hash_table<index_t, BBHCandidatesSet>;
-            using setShared_t = std::vector<std::atomic<bool>>;
-            using set_mutexs = std::vector<std::mutex>;
 
-        public:
-            using setShared_tp = setShared_t*;
-            using set_tp = set_t*;
-            using set_tr = set_t&;
-            using setShared_tr = setShared_t&;
-        
+            // un indice con epoca diversa da epoch_ appartiene a una coppia precedente
+            epoch_t epoch_;
+            epochs_t epochs_;
 
-        public:
-            using BBHCandidate_tr = BBHCandidate_t&;
-            using BBHCandidate_tm = BBHCandidate_t&&;
-            using BBHCandidatesSetReference = BBHCandidatesSet&;
-        private:
-            using matchSet_t = std::pair<index_t, set_tp>;
+            // miglior punteggio, primo candidato e testa della catena dei pari merito per ogni indice
+            scores_t bestScores_;
+            positions_t firstCandidates_;
+            positions_t ties_;
+
+            // i pari merito sono rari, l'arena condivisa e' protetta da un solo mutex
+            arena_t arena_;
+            std::mutex arenaMutex_;
+            using word_t = std::uint64_t;
+            using bitset_t = std::vector<std::atomic<word_t>>;
+
+            static constexpr index_t wordBits_ = 64;
 
         public:
-            using matchSet_tp = matchSet_t*;
+            using columns_t = std::vector<index_t>;
+            using range_t = std::pair<index_t, index_t>;
+            using ranges_t = std::vector<range_t>;
 
             /**
-             * @brief Constructs a BBHCandidatesContainer object with specified capacity and total number of columns.
+             * @brief Constructs a BBHCandidatesContainer object with specified capacity, every best score is 0.
              * 
              * @param capacity Capacity of the container.
-             * @param totalCols Total number of columns.
              */
-            inline explicit BBHCandidatesContainer(const index_t capacity, const index_t totalCols);
+            inline explicit BBHCandidatesContainer(const index_t capacity);
 
 
             BBHCandidatesContainer(const BBHCandidatesContainer&) = delete;
@@ -87,7 +106,17 @@ namespace bbh{
             ~BBHCandidatesContainer() = default;
             
             /**
-             * @brief Adds a candidate to the container at the specified index with the given score and new index.
+             * @brief Empties the container for a new genome pair of capacity indexes, in constant time unless
+             *        the arrays have to grow.
+             * 
+             * @param capacity Capacity of the container.
+             */
+            inline void reset(const index_t capacity);
+
+            /**
+             * @brief Adds a candidate to the container at the specified index with the given score and new index:
+             *        a greater score replaces the candidates, an equal score is appended, a lower one is ignored.
+             *        Tasks may add concurrently to different indexes, never to the same one.
              * 
              * @param candidateIndex Index of the candidate.
              * @param newScore New score of the candidate.
@@ -112,12 +141,25 @@ namespace bbh{
             inline void print(std::ostream& os) const;
             
             /**
-             * @brief Retrieves a pointer to a map containing possible matches between candidate indexes and sets of column indexes.
+             * @brief Retrieves the columns that are a candidate of at least one index. The rows are split in
+             *        ranges marking an atomic bitset with fetch_or, then the set bits are collected in order.
+             * 
+             * @param maxSize Number of columns.
+             * @param pool The pool running the marking tasks.
+             * @return The candidate columns, sorted.
+             */
+            inline columns_t getPossibleMatch(size_t maxSize, threads::ThreadPool& pool) const;
+
+            /**
+             * @brief Splits the sorted candidate columns in at most rangesNumber ranges of similar cost.
+             *        A column costs the number of rows (all equal), or with triangular the rows before it.
              * 
-             * @return Pointer to the map of possible matches.
+             * @param columns The sorted candidate columns.
+             * @param rangesNumber The wanted number of ranges.
+             * @param triangular True if only the rows before each column are scanned.
+             * @return The [first, second) positions in columns of every range.
              */
-            inline set_tp getPossibleMatch(size_t maxSize) const;
-            inline BBHCandidatesSet* getPossibleMatch(size_t maxSize, threads::ThreadPool& pool) const;
+            static inline ranges_t getBalancedRanges(const columns_t& columns, index_t rangesNumber, const bool triangular);
             
             /**
              * @brief Retrieves the capacity of the container.
@@ -127,30 +169,80 @@ namespace bbh{
             inline index_t getCapacity() const;
 
             /**
-             * @brief Retrieves a reference to the BBHCandidate at the specified index.
-             * 
-             * @param id Index of the BBHCandidate.
-             * @return Reference to the BBHCandidate at the specified index.
+             * @brief Calls f on every candidate with the best score at the specified index.
+             *
+             * @tparam F A callable taking the index of a candidate.
+             * @param id Index in the container.
+             * @param f The function to call.
              */
-            inline BBHCandidate_tr getCandidateAt(const index_t id);
+            template<typename F>
+            inline void forEachCandidate(const index_t id, F f) const;
     };
 
     inline
-    BBHCandidatesContainer::BBHCandidatesContainer(const index_t capacity, const index_t totalCols)
-    : capacity_(capacity){
-
-        candidates_.reserve(capacity);
-        for(index_t i = 0; i < capacity; ++i) {
-            BBHCandidate_t candidate(totalCols);
-            candidates_.emplace_back(
-                std::move(candidate)
-            );
+    BBHCandidatesContainer::BBHCandidatesContainer(const index_t capacity)
+    : capacity_(capacity), epoch_(1), epochs_(capacity, 0), bestScores_(capacity, 0), firstCandidates_(capacity, position_t(none_)), ties_(capacity, position_t(none_)) {}
+
+    inline void
+    BBHCandidatesContainer::reset(const index_t capacity) {
+        if(capacity > epochs_.size()) {
+            epochs_.resize(capacity, 0);
+            bestScores_.resize(capacity, 0);
+            firstCandidates_.resize(capacity, position_t(none_));
+            ties_.resize(capacity, position_t(none_));
+        }
+        capacity_ = capacity;
+        arena_.clear();
+
+        // al giro del contatore le epoche vecchie potrebbero coincidere: si azzerano
+        if(++epoch_ == 0) {
+            std::fill(epochs_.begin(), epochs_.end(), 0);
+            epoch_ = 1;
         }
     }
 
     inline void
     BBHCandidatesContainer::addCandidate(const index_t candidateIndex, const score_t newScore, const index_t newIndex) {
-        candidates_[candidateIndex].addCandidate(newScore, newIndex);
+
+        // confronto punteggio nuovo con quello attuale:
+        // se migliore resetto i candidati e tengo il nuovo indice inline
+        // se uguale aggiungo il nuovo indice (inline se e' il primo, altrimenti nell'arena)
+        // se minore viene ignorato
+
+        if(epochs_[candidateIndex] != epoch_) {
+            epochs_[candidateIndex] = epoch_;
+            bestScores_[candidateIndex] = 0;
+            firstCandidates_[candidateIndex] = none_;
+            ties_[candidateIndex] = none_;
+        }
+
+        score_t& bestScore = bestScores_[candidateIndex];
+        if(newScore > bestScore) {
+            bestScore = newScore;
+            firstCandidates_[candidateIndex] = static_cast<position_t>(newIndex);
+            ties_[candidateIndex] = none_;
+        } else if(newScore == bestScore) {
+            if(firstCandidates_[candidateIndex] == none_) {
+                firstCandidates_[candidateIndex] = static_cast<position_t>(newIndex);
+            } else {
+                std::unique_lock<std::mutex> lock(arenaMutex_);
+                TieNode node;
+                node.candidate = static_cast<position_t>(newIndex);
+                node.next = ties_[candidateIndex];
+                ties_[candidateIndex] = static_cast<position_t>(arena_.size());
+                arena_.push_back(node);
+            }
+        }
+    }
+
+    template<typename F>
+    inline void
+    BBHCandidatesContainer::forEachCandidate(const index_t id, F f) const {
+        if(epochs_[id] != epoch_ || firstCandidates_[id] == none_)
+            return;
+        f(static_cast<index_t>(firstCandidates_[id]));
+        for(position_t node = ties_[id]; node != none_; node = arena_[node].next)
+            f(static_cast<index_t>(arena_[node].candidate));
     }
 
     inline BBHCandidatesContainer::index_t
@@ -162,89 +254,88 @@ namespace bbh{
     BBHCandidatesContainer::print(std::ostream& os) const {
         for(index_t i = 0; i < capacity_; ++i) {
             os<<"\nCandidates for index "<<i<<":";
-            candidates_[i].print(os);
+            os<<"\nscore: "<<(epochs_[i] == epoch_ ? bestScores_[i] : 0)<<"\ncandidates {\n";
+            forEachCandidate(i, [&os](const index_t candidate) { os<<candidate<<" "; });
+            os<<"\n}\n";
         }
     }
 
-    // returned obj is not deallocated, return std::pair* with match max index, and a list og pairs, where:
-    // - first contains colums (secondary indexes)
-    // - second contains cadidates rows (main indexes)
-    inline BBHCandidatesContainer::BBHCandidatesSet*
+    // colonne candidate di almeno una riga, in ordine crescente
+    inline BBHCandidatesContainer::columns_t
     BBHCandidatesContainer::getPossibleMatch(size_t maxSize, threads::ThreadPool& pool) const {
-        
-        setShared_t bools(maxSize);
-        for (auto& b : bools) {
-            b.store(false, std::memory_order_relaxed);
+
+        bitset_t words((maxSize + wordBits_ - 1) / wordBits_);
+        for(auto& word : words) {
+            word.store(0, std::memory_order_relaxed);
         }
-        set_mutexs mutex_v(maxSize);
-
-        for(index_t i = 0; i < capacity_; ++i){
-
-            pool.execute(
-                [i, this, &bools, &mutex_v] {
-                    const auto& list = candidates_[i].getCandidateList();
-                    for(const auto& key : list) {
-                        // index_t key = *k;
-                        if(!bools[key].load(std::memory_order_acquire)) {
-                            std::unique_lock<std::mutex> lock(mutex_v[key]);
-                            if(!bools[key].load(std::memory_order_acquire)) {
-                                bools[key].store(true, std::memory_order_release);
-                            }
-                        }
+
+        // un task per intervallo di righe invece che per riga
+        const index_t tasks = 4 * pool.getTotalThread();
+        const index_t rowsPerTask = capacity_ / tasks + 1;
+        // solo i task di questa coppia: altre coppie possono usare il pool nel frattempo
+        threads::TaskGroup group(pool);
+        for(index_t first = 0; first < capacity_; first += rowsPerTask){
+            const index_t last = std::min(first + rowsPerTask, capacity_);
+
+            group.execute(
+                [first, last, this, &words] {
+                    for(index_t i = first; i < last; ++i) {
+                        forEachCandidate(i, [&words](const index_t key) {
+                            const word_t bit = word_t(1) << (key % wordBits_);
+                            // la lettura evita la scrittura (e il traffico sulla linea) se il bit e' gia' alto
+                            if(!(words[key / wordBits_].load(std::memory_order_relaxed) & bit))
+                                words[key / wordBits_].fetch_or(bit, std::memory_order_relaxed);
+                        });
                     }
                 }
             );
         }
 
-        // pool.waitTasks();
-        while(!pool.tasksCompleted()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        }
-        BBHCandidatesSet* map = new BBHCandidatesSet();
-        BBHCandidatesSet& mapRef = *map;
-        mapRef.reserve(maxSize);
-        for(index_t i = 0; i < maxSize; ++i){
-            if(bools[i].load(std::memory_order_relaxed))
-                mapRef.emplace(i);
-        }
-        return map;
-    }
-    inline BBHCandidatesContainer::set_tp
-    BBHCandidatesContainer::getPossibleMatch(size_t maxSize) const {
-        
-        set_tp map = new set_t();
-        set_tr mapRef = *map;
-        
-        for(index_t i = 0; i < capacity_; ++i){
-            
-            const auto& list = candidates_[i].getCandidateList();
-            for(auto k = list.begin(); k != list.end(); ++k) {
-                index_t key = *k;
-                auto mapIt = mapRef.find(key);
-                if(mapIt == mapRef.end()) {
-                    BBHCandidatesSet set;
-                    set.reserve(maxSize);
-                    set.insert(i);
-                    mapRef.insert(
-                        std::move(
-                            std::make_pair(key, std::move(set))
-                        )
-                    );
-                } else
-                    mapIt->second.insert(i);
+        group.wait();
+
+        columns_t columns;
+        for(index_t w = 0; w < words.size(); ++w) {
+            word_t word = words[w].load(std::memory_order_relaxed);
+            while(word != 0) {
+                columns.push_back(w * wordBits_ + __builtin_ctzll(word));
+                word &= word - 1;
             }
         }
-        return map;
+        return columns;
     }
 
-    inline BBHCandidatesContainer::BBHCandidate_tr
-    BBHCandidatesContainer::getCandidateAt(const index_t id) {
-        return candidates_[id];
+    inline BBHCandidatesContainer::ranges_t
+    BBHCandidatesContainer::getBalancedRanges(const columns_t& columns, index_t rangesNumber, const bool triangular) {
+        ranges_t ranges;
+        if(columns.empty())
+            return ranges;
+        if(rangesNumber == 0)
+            rangesNumber = 1;
+
+        // costo totale: una unita' per colonna, o le righe prima della colonna se triangolare
+        std::size_t total = 0;
+        for(auto col = columns.begin(); col != columns.end(); ++col)
+            total += triangular ? *col + 1 : 1;
+        const std::size_t target = total / rangesNumber + 1;
+
+        index_t first = 0;
+        std::size_t cost = 0;
+        for(index_t position = 0; position < columns.size(); ++position) {
+            cost += triangular ? columns[position] + 1 : 1;
+            if(cost >= target) {
+                ranges.emplace_back(first, position + 1);
+                first = position + 1;
+                cost = 0;
+            }
+        }
+        if(first < columns.size())
+            ranges.emplace_back(first, columns.size());
+        return ranges;
     }
 
     inline BBHCandidatesContainer::score_t
     BBHCandidatesContainer::getBestScoreForCandidate(const index_t candidateIndex) {
-        return candidates_[candidateIndex].getBestScore();
+        return epochs_[candidateIndex] == epoch_ ? bestScores_[candidateIndex] : 0;
     }
 
 }
@@ -0,0 +1,130 @@
+#ifndef BEST_SCORES_CONTAINER_INCLUDE_GUARD
+#define BEST_SCORES_CONTAINER_INCLUDE_GUARD 1
+
+#include <cstddef>
+#include <atomic>
+#include <vector>
+#include "../VariablesTypes.hh"
+
+
+
+/**
+ * @file BestScoresContainer.hh
+ * @brief Definitions for the BestScoresContainer class.
+ */
+
+/**
+ * @namespace bbh
+ * @brief Namespace containing definitions for Best Bidirectional Hits (BBH) related classes.
+ */
+
+namespace bbh {
+
+    /**
+     * @class BestScoresContainer
+     * @brief Keeps the best score seen so far for every index (e.g. every column of a genome pair).
+     *
+     * Updates are lock free, so row tasks running in parallel can publish their scores
+     * while other tasks read the current bests to prune their own comparisons.
+     * A best score can only grow: any value read is a lower bound of the final one.
+     */
+    class BestScoresContainer {
+        private:
+            using index_t = shared::indexType;
+            using score_t = shared::scoreType;
+            using bests_t = std::vector<std::atomic<score_t>>;
+
+            index_t capacity_;
+            bests_t bests_;
+
+        public:
+
+            BestScoresContainer() = delete;
+
+            /**
+             * @brief Constructs a BestScoresContainer with every best score set to 0.
+             *
+             * @param capacity Number of indexes.
+             */
+            inline explicit BestScoresContainer(const index_t capacity);
+
+            BestScoresContainer(const BestScoresContainer&) = delete;
+            BestScoresContainer(BestScoresContainer&&) = delete;
+            BestScoresContainer& operator=(const BestScoresContainer&) = delete;
+            BestScoresContainer& operator=(BestScoresContainer&&) = delete;
+
+            /**
+             * @brief Default destructor.
+             */
+            ~BestScoresContainer() = default;
+
+            /**
+             * @brief Sets capacity best scores back to 0, the storage is reused and grown only when needed.
+             *
+             * @param capacity Number of indexes.
+             */
+            inline void reset(const index_t capacity);
+
+            /**
+             * @brief Raises the best score of the index to score, if score is greater.
+             *
+             * @param index Index to update.
+             * @param score New score.
+             */
+            inline void update(const index_t index, const score_t score);
+
+            /**
+             * @brief Retrieves the current best score for the index.
+             *
+             * @param index Index to read.
+             * @return Best score seen so far.
+             */
+            inline score_t getBestScore(const index_t index) const;
+
+            /**
+             * @brief Retrieves the capacity of the container.
+             *
+             * @return Capacity of the container.
+             */
+            inline index_t getCapacity() const;
+    };
+
+    inline
+    BestScoresContainer::BestScoresContainer(const index_t capacity)
+    : capacity_(capacity), bests_(capacity) {
+        for(auto& b : bests_) {
+            b.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    inline void
+    BestScoresContainer::reset(const index_t capacity) {
+        // gli atomic non si spostano: se serve piu' spazio si crea un nuovo vettore
+        if(capacity > bests_.size())
+            bests_t(capacity).swap(bests_);
+        capacity_ = capacity;
+        for(index_t i = 0; i < capacity_; ++i) {
+            bests_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    inline void
+    BestScoresContainer::update(const index_t index, const score_t score) {
+        score_t current = bests_[index].load(std::memory_order_relaxed);
+        // compare_exchange_weak ricarica current se un altro thread lo ha modificato
+        while(score > current && !bests_[index].compare_exchange_weak(current, score, std::memory_order_relaxed)) {}
+    }
+
+    inline BestScoresContainer::score_t
+    BestScoresContainer::getBestScore(const index_t index) const {
+        return bests_[index].load(std::memory_order_relaxed);
+    }
+
+    inline BestScoresContainer::index_t
+    BestScoresContainer::getCapacity() const {
+        return capacity_;
+    }
+
+}
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef COLUMN_HITS_CONTAINER_INCLUDE_GUARD
+#define COLUMN_HITS_CONTAINER_INCLUDE_GUARD 1
+
+#include <cstdint>
+#include <vector>
+#include "../VariablesTypes.hh"
+
+
+
+/**
+ * @file ColumnHitsContainer.hh
+ * @brief Definitions for the ColumnHitsContainer class.
+ */
+
+/**
+ * @namespace bbh
+ * @brief Namespace containing definitions for Best Bidirectional Hits (BBH) related classes.
+ */
+
+namespace bbh {
+
+    /**
+     * @class ColumnHitsContainer
+     * @brief Collects, for every tile of a genome pair, the scores that reached the best of their column.
+     *
+     * The best score of every column is kept lock free by a BestScoresContainer; when a score is
+     * greater or equal to the current best of its column the tile appends (row, col, score) to its
+     * own slot. Every tile owns a slot, so no lock is taken. Once all the tiles are completed a hit is
+     * a column best if its score is equal to the final best of the column, the other hits were
+     * overtaken later and are skipped by the post-pass.
+     */
+    class ColumnHitsContainer {
+        public:
+            using index_t = shared::indexType;
+            using score_t = shared::scoreType;
+
+            /**
+             * @brief A score that reached the best of its column when it was computed.
+             */
+            struct Hit {
+                std::uint32_t row;
+                std::uint32_t col;
+                score_t score;
+            };
+
+            using hits_t = std::vector<Hit>;
+            using hits_tr = hits_t&;
+
+        private:
+            using slots_t = std::vector<hits_t>;
+
+            slots_t slots_;
+            // gli slot oltre slotsNumber_ restano allocati per le coppie successive
+            index_t slotsNumber_;
+
+        public:
+            /**
+             * @brief Constructs an empty container, resize must be called before the tiles are submitted.
+             */
+            ColumnHitsContainer() : slotsNumber_(0) {}
+
+            ColumnHitsContainer(const ColumnHitsContainer&) = delete;
+            ColumnHitsContainer(ColumnHitsContainer&&) = delete;
+            ColumnHitsContainer& operator=(const ColumnHitsContainer&) = delete;
+            ColumnHitsContainer& operator=(ColumnHitsContainer&&) = delete;
+
+            /**
+             * @brief Default destructor.
+             */
+            ~ColumnHitsContainer() = default;
+
+            /**
+             * @brief Creates one empty slot per tile, the previous hits are discarded but the memory of the slots is kept.
+             *
+             * @param slotsNumber Number of tiles.
+             */
+            inline void resize(const index_t slotsNumber);
+
+            /**
+             * @brief Retrieves the hits of a tile, only the tile may modify them while the pair is computed.
+             *
+             * @param slot Index of the tile.
+             * @return Reference to the hits of the tile.
+             */
+            inline hits_tr getSlot(const index_t slot);
+
+            /**
+             * @brief Retrieves the number of slots.
+             *
+             * @return Number of tiles.
+             */
+            inline index_t getSlotsNumber() const;
+    };
+
+    inline void
+    ColumnHitsContainer::resize(const index_t slotsNumber) {
+        for(auto slot = slots_.begin(); slot != slots_.end(); ++slot)
+            slot->clear();
+        if(slotsNumber > slots_.size())
+            slots_.resize(slotsNumber);
+        slotsNumber_ = slotsNumber;
+    }
+
+    inline ColumnHitsContainer::hits_tr
+    ColumnHitsContainer::getSlot(const index_t slot) {
+        return slots_[slot];
+    }
+
+    inline ColumnHitsContainer::index_t
+    ColumnHitsContainer::getSlotsNumber() const {
+        return slotsNumber_;
+    }
+
+}
+
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef EDGES_CONTAINER_INCLUDE_GUARD
+#define EDGES_CONTAINER_INCLUDE_GUARD 1
+
+#include <cstdint>
+#include <vector>
+#include <mutex>
+#include "../VariablesTypes.hh"
+
+
+
+/**
+ * @file EdgesContainer.hh
+ * @brief Definitions for the EdgesContainer class.
+ */
+
+/**
+ * @namespace bbh
+ * @brief Namespace containing definitions for Best Bidirectional Hits (BBH) related classes.
+ */
+
+namespace bbh {
+
+    /**
+     * @class EdgesContainer
+     * @brief The Bidirectional Best Hits found for a genome pair, with the genes as indexes in their genomes.
+     *
+     * The edges do not depend on the position of the genomes in the input file: they are converted
+     * to file positions only when the pair is written, so the edges of a pair computed in another
+     * run (see homology::RunState) can be written as they are.
+     */
+    class EdgesContainer {
+        public:
+            using index_t = shared::indexType;
+            using score_t = shared::scoreType;
+
+            /**
+             * @brief A BBH between the gene row of the row genome and the gene col of the column genome.
+             */
+            struct Edge {
+                std::uint32_t row;
+                std::uint32_t col;
+                score_t score;
+            };
+
+            using edges_t = std::vector<Edge>;
+            using edges_ctr = const edges_t&;
+
+        private:
+            edges_t edges_;
+            std::mutex mutex_;
+
+        public:
+            /**
+             * @brief Constructs an empty container.
+             */
+            EdgesContainer() = default;
+
+            EdgesContainer(const EdgesContainer&) = delete;
+            EdgesContainer(EdgesContainer&&) = delete;
+            EdgesContainer& operator=(const EdgesContainer&) = delete;
+            EdgesContainer& operator=(EdgesContainer&&) = delete;
+
+            /**
+             * @brief Default destructor.
+             */
+            ~EdgesContainer() = default;
+
+            /**
+             * @brief Removes the edges, keeping the memory for the next pair.
+             */
+            inline void reset() {
+                edges_.clear();
+            }
+
+            /**
+             * @brief Adds an edge, thread safe.
+             *
+             * @param row The index of the gene in the row genome.
+             * @param col The index of the gene in the column genome.
+             * @param score The score of the BBH.
+             */
+            inline void add(const index_t row, const index_t col, const score_t score) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                edges_.push_back(Edge{static_cast<std::uint32_t>(row), static_cast<std::uint32_t>(col), score});
+            }
+
+            /**
+             * @brief Adds the edges of a pair computed before, not thread safe.
+             *
+             * @param edges The edges.
+             * @param transposed True if the edges have been computed with the row and column genomes swapped.
+             */
+            inline void add(edges_ctr edges, const bool transposed) {
+                for(auto edge = edges.begin(); edge != edges.end(); ++edge)
+                    edges_.push_back(transposed ? Edge{edge->col, edge->row, edge->score} : *edge);
+            }
+
+            /**
+             * @brief Retrieves the edges, once the pair is completed.
+             *
+             * @return The edges.
+             */
+            inline edges_ctr getEdges() const {
+                return edges_;
+            }
+    };
+
+}
+
+
+#endif
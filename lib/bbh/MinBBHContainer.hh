@@ -24,8 +24,6 @@ namespace bbh {
         line_ct halfMatrix_;
         index_t rows_;
         line_t mins_;
-
-        inline score_t getVal(const index_t row, const index_t col) const;
     public:
 
         inline explicit MinBBHContainer();
@@ -33,6 +31,9 @@ namespace bbh {
         ~MinBBHContainer();
         inline void print() const;
         inline void setVal(const index_t row, const index_t col, const score_t min);
+        inline score_t getVal(const index_t row, const index_t col) const;
+        // il minimo di row, da chiamare quando tutte le coppie con row sono state impostate
+        inline void computeMin(const index_t row);
         inline void computeMins(pool_tr pool);
         inline score_t getMin(const index_t row) const;
 
@@ -90,68 +91,33 @@ namespace bbh {
     }
 
     inline void
-        MinBBHContainer::computeMins(pool_tr pool) {
-
-        index_t effectiveRows = rows_ - 1;
-        if (effectiveRows == 0) {
+        MinBBHContainer::computeMin(const index_t row) {
+        if (rows_ == 1) {
             mins_[0] = 0;
             return;
         }
 
-        pool.execute(
-            [this] {
-                auto c = halfMatrix_[0].begin();
-                score_t currentMin = *c;
-                ++c;
-                for (; c != halfMatrix_[0].end(); ++c) {
-                    currentMin = *c < currentMin ? *c : currentMin;
-                }
-                mins_[0] = currentMin;
-            }
-        );
-
-        for (index_t r = 1; r < effectiveRows; ++r) {
+        // coppie (p, row) con p < row, poi (row, c) con c > row
+        score_t currentMin = 2;
+        for (index_t p = 0; p < row; ++p) {
+            score_t tmp = getVal(p, row);
+            currentMin = tmp < currentMin ? tmp : currentMin;
+        }
+        for (auto c = halfMatrix_[row].begin(); c != halfMatrix_[row].end(); ++c) {
+            currentMin = *c < currentMin ? *c : currentMin;
+        }
+        mins_[row] = currentMin;
+    }
 
+    inline void
+        MinBBHContainer::computeMins(pool_tr pool) {
+        for (index_t r = 0; r < rows_; ++r) {
             pool.execute(
                 [this, r] {
-                    auto c = halfMatrix_[r].begin();
-                    score_t currentMin = *c;
-                    ++c;
-                    for (; c != halfMatrix_[r].end(); ++c) {
-                        currentMin = *c < currentMin ? *c : currentMin;
-                    }
-                    index_t p = r - 1;
-                    for (; p > 0; --p) {
-                        score_t tmp = getVal(p, r);
-                        currentMin = tmp < currentMin ? tmp : currentMin;
-                    }
-                    // p = 0
-                    score_t tmp = getVal(p, r);
-                    currentMin = tmp < currentMin ? tmp : currentMin;
-                    mins_[r] = currentMin;
+                    computeMin(r);
                 }
             );
-
-
-
         }
-
-        // last row
-        pool.execute(
-            [this, effectiveRows] {
-                index_t p = effectiveRows - 1;
-                score_t currentMin = getVal(p, effectiveRows);
-                --p;
-                for (; p > 0; --p) {
-                    score_t tmp = getVal(p, effectiveRows);
-                    currentMin = tmp < currentMin ? tmp : currentMin;
-                }
-                // p = 0
-                score_t tmp = getVal(p, effectiveRows);
-                currentMin = tmp < currentMin ? tmp : currentMin;
-                mins_[effectiveRows] = currentMin;
-            }
-        );
         while (!pool.tasksCompleted()) {
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
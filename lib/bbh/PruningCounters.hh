@@ -0,0 +1,133 @@
+#ifndef PRUNING_COUNTERS_INCLUDE_GUARD
+#define PRUNING_COUNTERS_INCLUDE_GUARD 1
+
+#include <cstddef>
+#include <atomic>
+#include <iostream>
+#include "../VariablesTypes.hh"
+
+
+
+/**
+ * @file PruningCounters.hh
+ * @brief Definitions for the PruningCounters class.
+ */
+
+/**
+ * @namespace bbh
+ * @brief Namespace containing definitions for Best Bidirectional Hits (BBH) related classes.
+ */
+
+namespace bbh {
+
+    /**
+     * @class PruningCounters
+     * @brief Counts how the gene pairs of a comparison were resolved by the bound-driven BBH search.
+     *
+     * - discarded: the length cut (-d) excluded the pair
+     * - pruned: the upper bound of the score could not reach the row/column best, the merge was skipped
+     * - aborted: the merge started but stopped once the remaining kmers could not reach the threshold
+     * - computed: the merge ran to the end
+     *
+     * Row tasks accumulate locally and call add once, so the atomics are not contended.
+     */
+    class PruningCounters {
+        private:
+            using counter_t = std::atomic<std::size_t>;
+
+            counter_t discarded_;
+            counter_t pruned_;
+            counter_t aborted_;
+            counter_t computed_;
+
+        public:
+
+            /**
+             * @brief Constructs a PruningCounters object with every counter set to 0.
+             */
+            inline PruningCounters();
+
+            PruningCounters(const PruningCounters&) = delete;
+            PruningCounters(PruningCounters&&) = delete;
+            PruningCounters& operator=(const PruningCounters&) = delete;
+            PruningCounters& operator=(PruningCounters&&) = delete;
+
+            /**
+             * @brief Adds the given values to the counters.
+             *
+             * @param discarded Pairs excluded by the length cut.
+             * @param pruned Pairs skipped by the upper bound.
+             * @param aborted Merges stopped early.
+             * @param computed Merges completed.
+             */
+            inline void add(const std::size_t discarded, const std::size_t pruned, const std::size_t aborted, const std::size_t computed);
+
+            /**
+             * @brief Adds the values of other to the counters.
+             *
+             * @param other Counters to accumulate.
+             */
+            inline void add(const PruningCounters& other);
+
+            inline std::size_t getDiscarded() const;
+            inline std::size_t getPruned() const;
+            inline std::size_t getAborted() const;
+            inline std::size_t getComputed() const;
+
+            /**
+             * @brief Prints the counters to the output stream.
+             *
+             * @param os Reference to the output stream.
+             */
+            inline void print(std::ostream& os) const;
+    };
+
+    inline
+    PruningCounters::PruningCounters() {
+        discarded_.store(0, std::memory_order_relaxed);
+        pruned_.store(0, std::memory_order_relaxed);
+        aborted_.store(0, std::memory_order_relaxed);
+        computed_.store(0, std::memory_order_relaxed);
+    }
+
+    inline void
+    PruningCounters::add(const std::size_t discarded, const std::size_t pruned, const std::size_t aborted, const std::size_t computed) {
+        discarded_.fetch_add(discarded, std::memory_order_relaxed);
+        pruned_.fetch_add(pruned, std::memory_order_relaxed);
+        aborted_.fetch_add(aborted, std::memory_order_relaxed);
+        computed_.fetch_add(computed, std::memory_order_relaxed);
+    }
+
+    inline void
+    PruningCounters::add(const PruningCounters& other) {
+        add(other.getDiscarded(), other.getPruned(), other.getAborted(), other.getComputed());
+    }
+
+    inline std::size_t
+    PruningCounters::getDiscarded() const {
+        return discarded_.load(std::memory_order_relaxed);
+    }
+
+    inline std::size_t
+    PruningCounters::getPruned() const {
+        return pruned_.load(std::memory_order_relaxed);
+    }
+
+    inline std::size_t
+    PruningCounters::getAborted() const {
+        return aborted_.load(std::memory_order_relaxed);
+    }
+
+    inline std::size_t
+    PruningCounters::getComputed() const {
+        return computed_.load(std::memory_order_relaxed);
+    }
+
+    inline void
+    PruningCounters::print(std::ostream& os) const {
+        os<<"discarded: "<<getDiscarded()<<", pruned: "<<getPruned()<<", aborted: "<<getAborted()<<", computed: "<<getComputed();
+    }
+
+}
+
+#endif
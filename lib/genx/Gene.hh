@@ -115,10 +115,21 @@ namespace gene {
              * @brief Calculates the kmers for the gene using the specified KmerMapper.
              * The KmersContainer must have been created previously.
              * 
+             * @tparam K The length of the kmers if known at compile time (packed kmers), 0 otherwise.
              * @param mapper The KmerMapper to use for calculation.
              */
+            template<k_t K = 0>
             inline void calculateKmers(kmerMapper_tr mapper);
             
+            /**
+             * @brief Uses kmers stored outside the gene (a mapped spill file) instead of calculating them.
+             * The KmersContainer is created if it does not exist.
+             * @param k The length of the kmers.
+             * @param kmers The kmers sorted by id, they must outlive the KmersContainer.
+             * @param size The number of kmers.
+             */
+            inline void attachKmers(const k_t k, const kmersContainer_t::kmer_t* kmers, const index_t size);
+
             /**
              * @brief Deletes the kmersContainer associated with the gene.
              * The kmersContainer must have been created previously.
@@ -263,6 +274,14 @@ namespace gene {
         kmers_ = new kmersContainer_t(k, alphabet_, alphabetLength_);
     }
 
+    inline void
+    Gene::attachKmers(const k_t k, const kmersContainer_t::kmer_t* kmers, const index_t size) {
+        if(kmers_ == nullptr)
+            createNewKmers(k);
+        kmers_->attach(kmers, size);
+        kmersNumber_ = size;
+    }
+
     // ! il kmer container deve essere almeno stato creato o calcolato
     inline void
     Gene::deleteKmers() {
@@ -283,9 +302,13 @@ namespace gene {
     }
 
     // ! il kmer handler deve essere creato precedentemente
+    template<Gene::k_t K>
     inline void
     Gene::calculateKmers(kmerMapper_tr mapper) {
-        kmers_->calculateKmers(mapper);
+        if(K == 0)
+            kmers_->calculateKmers(mapper);
+        else
+            kmers_->template calculatePackedKmers<K>(mapper);
         kmersNumber_ = kmers_->getDifferentKmersNumber();
     }
     
@@ -7,9 +7,11 @@
 #include <cstddef>
 #include <vector>
 #include <memory>
+#include <algorithm>
 #include "../VariablesTypes.hh"
 #include "Gene.hh"
 #include "../../threads/ThreadPool.hh"
+#include "../../threads/TaskGroup.hh"
 
 /**
  * @file Genome.hh
@@ -48,11 +50,18 @@ namespace genome {
             using gene_ctp = gene_ct*;
             using gene_ctr = gene_ct&;
         private:
+            using order_ct = std::vector<index_t>;
+        public:
+            using order_ctr = const order_ct&;
+        private:
 
             index_t genomeId_;
             index_t size_;
             gene_ct genes_;
 
+            // permutazione degli indici dei geni ordinata per lunghezza della sequenza
+            order_ct lengthOrder_;
+
         public:
 
             Genome() = delete;
@@ -111,12 +120,27 @@ namespace genome {
              * @return A constant reference to the gene at the specified index.
              */
             inline gene_tr const getGeneAt(index_t index);
+
+            /**
+             * @brief Computes the permutation of the gene indexes sorted by sequence length.
+             * Must be called again if genes are added after it.
+             */
+            inline void calculateLengthOrder();
+
+            /**
+             * @brief Gets the permutation of the gene indexes sorted by sequence length (ascending).
+             * Genes with the same length keep the file order.
+             * @return A constant reference to the permutation.
+             */
+            inline order_ctr getLengthOrder() const;
             
             /**
              * @brief Creates and calculates kmers for all genes in the genome.
+             * @tparam K The length of kmers if known at compile time (packed kmers), 0 otherwise.
              * @param k The length of kmers.
              * @param mapper The k-mer mapper object to use.
              */
+            template<k_t K = 0>
             inline void createAndCalculateAllKmers(k_t k, kmerMapper_tr mapper);
             
             /**
@@ -125,6 +149,12 @@ namespace genome {
              */
             inline void deleteAllKmers(thread_ptr pool);
 
+            /**
+             * @brief Gets the memory used by the kmers of the genes, 0 if they are not calculated.
+             * @return The number of bytes.
+             */
+            inline std::size_t getKmersMemoryUsage() const;
+
 
             /**
              * @brief Checks if two genomes are equal.
@@ -163,7 +193,7 @@ namespace genome {
     
     inline
     Genome::Genome(const Genome &other) noexcept
-    : genomeId_(other.genomeId_), size_(other.size_), genes_(other.genes_) {}
+    : genomeId_(other.genomeId_), size_(other.size_), genes_(other.genes_), lengthOrder_(other.lengthOrder_) {}
     
     inline Genome&
     Genome::operator=(const Genome &other) noexcept {
@@ -171,13 +201,14 @@ namespace genome {
             genomeId_ = other.genomeId_;
             size_ = other.size_;
             genes_ = other.genes_;
+            lengthOrder_ = other.lengthOrder_;
         }
         return *this;
     }
     
     inline
     Genome::Genome(Genome &&other) noexcept
-    : genomeId_(other.genomeId_), size_(other.size_), genes_(std::move(other.genes_)) {
+    : genomeId_(other.genomeId_), size_(other.size_), genes_(std::move(other.genes_)), lengthOrder_(std::move(other.lengthOrder_)) {
     }
 
     inline Genome&
@@ -186,6 +217,7 @@ namespace genome {
             genomeId_ = other.genomeId_;
             size_ = other.size_;
             genes_ = std::move(other.genes_);
+            lengthOrder_ = std::move(other.lengthOrder_);
         }
         return *this;
     };
@@ -219,26 +251,54 @@ namespace genome {
         return genes_[index];
     }
 
+    inline void
+    Genome::calculateLengthOrder() {
+        lengthOrder_.resize(genes_.size());
+        for(index_t i = 0; i < genes_.size(); ++i)
+            lengthOrder_[i] = i;
+
+        std::stable_sort(lengthOrder_.begin(), lengthOrder_.end(),
+            [this](const index_t a, const index_t b) {
+                return genes_[a].getAlphabetLength() < genes_[b].getAlphabetLength();
+            }
+        );
+    }
+
+    inline Genome::order_ctr
+    Genome::getLengthOrder() const {
+        return lengthOrder_;
+    }
+
+    template<Genome::k_t K>
     inline void
     Genome::createAndCalculateAllKmers(k_t k, kmerMapper_tr mapper){
         for(auto g = genes_.begin(); g != genes_.end(); ++g){
             auto& gRef = *g;
             gRef.createNewKmers(k);
-            gRef.calculateKmers(mapper);
+            gRef.template calculateKmers<K>(mapper);
         }
     }
     inline void
     Genome::deleteAllKmers(thread_ptr pool) {
+        // solo i task di questo genoma: altre coppie possono usare il pool nel frattempo
+        threads::TaskGroup group(pool);
         for(auto g = genes_.begin(); g != genes_.end(); ++g){
-            pool.execute(
+            group.execute(
                 [g] {
                     g->deleteKmers();
                 }
             );
         }
-        // pool.waitTasks();
-        while(!pool.tasksCompleted())
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        group.wait();
+    }
+
+    inline std::size_t
+    Genome::getKmersMemoryUsage() const {
+        std::size_t bytes = 0;
+        for(auto g = genes_.begin(); g != genes_.end(); ++g)
+            if(g->getKmerContainer() != nullptr)
+                bytes += g->getKmerContainer()->getMemoryUsage();
+        return bytes;
     }
 
     // ritorna il numero di geni
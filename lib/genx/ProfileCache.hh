@@ -0,0 +1,233 @@
+#ifndef PROFILE_CACHE_INCLUDE_GUARD
+#define PROFILE_CACHE_INCLUDE_GUARD 1
+
+#include <cstddef>
+#include <vector>
+#include <iostream>
+#include "../VariablesTypes.hh"
+#include "../kmers/KmerMapper.hh"
+#include "Genome.hh"
+#include "ProfileStore.hh"
+#include "../../threads/ThreadPool.hh"
+
+
+/**
+ * @file ProfileCache.hh
+ * @brief Definitions for the ProfileCache class.
+ */
+
+/**
+ * @namespace genome
+ * @brief Namespace containing definitions for genome related classes.
+ */
+
+namespace genome {
+
+    /**
+     * @class ProfileCache
+     * @brief Keeps the kmers of the genomes computed in the mode with lower RAM cost, within a memory budget.
+     *
+     * A genome is acquired before being compared and released afterwards: its kmers are computed
+     * only if they are not resident. When the resident kmers exceed the budget the least recently
+     * used released genomes are evicted; the acquired ones are never evicted, so the budget can be
+     * exceeded by the genomes being compared. All the genomes share one KmerMapper, so the kmers
+     * computed for a pair can be reused by any other pair; its vocabulary only grows and is counted in
+     * the budget too (see KmerMapper::getMemoryUsage), the genomes are evicted to make room for it.
+     * With a ProfileStore the kmers are computed once: they are spilled to disk after the computation
+     * and mapped again after an eviction.
+     */
+    class ProfileCache {
+        private:
+            using index_t = shared::indexType;
+            using k_t = shared::kType;
+            using genome_t = Genome;
+            using genome_tr = genome_t&;
+            using kmerMapper_t = kmers::KmerMapper;
+            using thread_pt = threads::ThreadPool;
+            using thread_ptr = thread_pt&;
+            using store_tp = ProfileStore*;
+
+            // stato di un genoma nella cache
+            struct Entry {
+                bool resident;
+                index_t pins;
+                std::size_t bytes;
+                std::size_t lastUse;
+            };
+
+            using entries_t = std::vector<Entry>;
+
+            std::size_t budget_;
+            thread_ptr pool_;
+            store_tp store_;
+            kmerMapper_t mapper_;
+            entries_t entries_;
+            std::vector<genome_t*> genomes_;
+            // kmer residenti e vocabolario del mapper
+            std::size_t used_;
+            std::size_t mapperBytes_;
+            std::size_t peak_;
+            std::size_t clock_;
+            std::size_t hits_;
+            std::size_t builds_;
+            std::size_t loads_;
+
+            /**
+             * @brief Evicts the least recently used released genomes until the resident kmers fit in the budget.
+             */
+            inline void shrink();
+
+        public:
+            /**
+             * @brief Constructs an empty cache.
+             * @param genomesNumber The number of genomes, their ids go from 0 to genomesNumber - 1.
+             * @param budget The bytes of kmers and of the mapper vocabulary that can stay resident.
+             * @param pool The pool used to delete the kmers of the evicted genomes.
+             * @param store The store of the computed kmers, nullptr to compute again the evicted ones. It must outlive the cache.
+             */
+            inline explicit ProfileCache(const index_t genomesNumber, const std::size_t budget, thread_ptr pool, store_tp store = nullptr);
+
+            ProfileCache(const ProfileCache&) = delete;
+            ProfileCache& operator=(const ProfileCache&) = delete;
+            ProfileCache(ProfileCache&&) = delete;
+            ProfileCache& operator=(ProfileCache&&) = delete;
+
+            /**
+             * @brief Deletes the kmers still resident.
+             */
+            inline ~ProfileCache();
+
+            /**
+             * @brief Makes the kmers of a genome resident and keeps them until release.
+             * @tparam K The length of kmers if known at compile time (packed kmers), 0 otherwise.
+             * @param genome The genome.
+             * @param k The length of kmers.
+             */
+            template<k_t K = 0>
+            inline void acquire(genome_tr genome, const k_t k);
+
+            /**
+             * @brief Allows the kmers of an acquired genome to be evicted.
+             * @param genome The genome.
+             */
+            inline void release(genome_tr genome);
+
+            /**
+             * @brief Deletes the kmers of a released genome that will not be compared again.
+             * @param genome The genome.
+             */
+            inline void evict(genome_tr genome);
+
+            /**
+             * @brief Gets the memory used by the resident kmers and by the mapper vocabulary.
+             * @return The number of bytes.
+             */
+            inline std::size_t getUsedMemory() const noexcept {
+                return used_;
+            }
+
+            /**
+             * @brief Prints the number of hits, builds and loads from the store and the peak of resident kmers.
+             * @param os The output stream.
+             */
+            inline void print(std::ostream& os) const;
+    };
+
+    inline
+    ProfileCache::ProfileCache(const index_t genomesNumber, const std::size_t budget, thread_ptr pool, store_tp store)
+    : budget_(budget), pool_(pool), store_(store), entries_(genomesNumber, Entry{false, 0, 0, 0}), genomes_(genomesNumber, nullptr),
+    used_(0), mapperBytes_(0), peak_(0), clock_(0), hits_(0), builds_(0), loads_(0) {}
+
+    inline
+    ProfileCache::~ProfileCache() {
+        for(index_t id = 0; id < entries_.size(); ++id)
+            if(entries_[id].resident) {
+                if(store_ != nullptr)
+                    store_->unmap(*genomes_[id], pool_);
+                else
+                    genomes_[id]->deleteAllKmers(pool_);
+            }
+    }
+
+    template<ProfileCache::k_t K>
+    inline void
+    ProfileCache::acquire(genome_tr genome, const k_t k) {
+        Entry& entry = entries_[genome.getId()];
+        entry.lastUse = ++clock_;
+        ++entry.pins;
+
+        if(entry.resident) {
+            ++hits_;
+            return;
+        }
+
+        if(store_ != nullptr && store_->contains(genome)) {
+            store_->map(genome, k);
+            ++loads_;
+        } else {
+            genome.createAndCalculateAllKmers<K>(k, mapper_);
+            ++builds_;
+            if(store_ != nullptr)
+                store_->spill(genome, k);
+
+            // i kmer nuovi del genoma restano nel vocabolario anche dopo l'eviction
+            std::size_t mapperBytes = mapper_.getMemoryUsage();
+            used_ += mapperBytes - mapperBytes_;
+            mapperBytes_ = mapperBytes;
+        }
+        genomes_[genome.getId()] = &genome;
+        entry.resident = true;
+        entry.bytes = genome.getKmersMemoryUsage();
+        used_ += entry.bytes;
+        peak_ = used_ > peak_ ? used_ : peak_;
+
+        shrink();
+    }
+
+    inline void
+    ProfileCache::release(genome_tr genome) {
+        --entries_[genome.getId()].pins;
+        shrink();
+    }
+
+    inline void
+    ProfileCache::evict(genome_tr genome) {
+        Entry& entry = entries_[genome.getId()];
+        if(!entry.resident || entry.pins != 0)
+            return;
+
+        if(store_ != nullptr)
+            store_->unmap(genome, pool_);
+        else
+            genome.deleteAllKmers(pool_);
+        entry.resident = false;
+        used_ -= entry.bytes;
+        entry.bytes = 0;
+    }
+
+    inline void
+    ProfileCache::shrink() {
+        while(used_ > budget_) {
+            // il meno recente tra i genomi non in uso, la scansione e' lineare nei genomi
+            index_t victim = entries_.size();
+            for(index_t id = 0; id < entries_.size(); ++id) {
+                const Entry& entry = entries_[id];
+                if(entry.resident && entry.pins == 0 && (victim == entries_.size() || entry.lastUse < entries_[victim].lastUse))
+                    victim = id;
+            }
+            if(victim == entries_.size())
+                return;
+            evict(*genomes_[victim]);
+        }
+    }
+
+    inline void
+    ProfileCache::print(std::ostream& os) const {
+        os<<"hits: "<<hits_<<", builds: "<<builds_<<", loads: "<<loads_<<", peak: "<<peak_ / (1024 * 1024)<<" MiB";
+        os<<", mapper: "<<mapperBytes_ / (1024 * 1024)<<" MiB";
+    }
+
+}
+
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef PROFILE_STORE_INCLUDE_GUARD
+#define PROFILE_STORE_INCLUDE_GUARD 1
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "../VariablesTypes.hh"
+#include "../kmers/KmersContainer.hh"
+#include "Genome.hh"
+#include "../../threads/ThreadPool.hh"
+
+
+/**
+ * @file ProfileStore.hh
+ * @brief Definitions for the ProfileStore class.
+ */
+
+/**
+ * @namespace genome
+ * @brief Namespace containing definitions for genome related classes.
+ */
+
+namespace genome {
+
+    /**
+     * @class ProfileStore
+     * @brief Keeps the kmers of the genomes in a spill file, so that they are mapped again instead of computed again.
+     *
+     * The kmers of every gene of a genome are written one after the other in a region of the file,
+     * then the genes use them through the mapping of the region (see kmers::KmersContainer::attach)
+     * and their dictionaries are released. The region of a genome is contiguous and read ahead as a
+     * whole when mapped. The file is removed as soon as it is created: it is released when the store
+     * is destroyed, also if the process is interrupted. The kmer ids are those of the mapper used to
+     * compute them, so every genome of a store must be computed with the same mapper.
+     */
+    class ProfileStore {
+        private:
+            using index_t = shared::indexType;
+            using k_t = shared::kType;
+            using genome_tr = Genome&;
+            using kmer_t = kmers::KmersContainer::kmer_t;
+            using thread_pt = threads::ThreadPool;
+            using thread_ptr = thread_pt&;
+
+            // regione del file con i kmer di un genoma
+            struct Region {
+                bool stored;
+                off_t offset;
+                std::size_t bytes;
+                // kmer di ogni gene, nell'ordine dei geni
+                std::vector<index_t> sizes;
+                void* mapping;
+            };
+
+            int fd_;
+            off_t end_;
+            std::size_t pageSize_;
+            std::vector<Region> regions_;
+            std::size_t written_;
+            std::size_t maps_;
+
+            /**
+             * @brief Throws a runtime_error with the description of errno.
+             * @param what The failed operation.
+             */
+            [[noreturn]] inline static void fail(const std::string& what);
+
+        public:
+            /**
+             * @brief Creates the spill file.
+             * @param directory The directory of the file, on a local disk.
+             * @param genomesNumber The number of genomes, their ids go from 0 to genomesNumber - 1.
+             */
+            inline explicit ProfileStore(const std::string& directory, const index_t genomesNumber);
+
+            ProfileStore(const ProfileStore&) = delete;
+            ProfileStore& operator=(const ProfileStore&) = delete;
+            ProfileStore(ProfileStore&&) = delete;
+            ProfileStore& operator=(ProfileStore&&) = delete;
+
+            /**
+             * @brief Unmaps the regions and closes the file. The genomes must not use the mapped kmers anymore.
+             */
+            inline ~ProfileStore();
+
+            /**
+             * @brief Checks if the kmers of a genome are in the file.
+             * @param genome The genome.
+             * @return True if spill has been called for the genome.
+             */
+            inline bool contains(genome_tr genome) const;
+
+            /**
+             * @brief Writes the calculated kmers of a genome in the file, then the genome uses them from the mapping.
+             * @param genome The genome, with the kmers calculated.
+             * @param k The length of kmers.
+             */
+            inline void spill(genome_tr genome, const k_t k);
+
+            /**
+             * @brief Maps the region of a genome in the file and attaches the kmers to its genes.
+             * @param genome The genome, stored and not mapped.
+             * @param k The length of kmers.
+             */
+            inline void map(genome_tr genome, const k_t k);
+
+            /**
+             * @brief Deletes the kmers of a genome and unmaps its region, which stays in the file.
+             * @param genome The genome.
+             * @param pool The pool used to delete the kmers.
+             */
+            inline void unmap(genome_tr genome, thread_ptr pool);
+
+            /**
+             * @brief Prints the bytes written in the file and the number of mappings.
+             * @param os The output stream.
+             */
+            inline void print(std::ostream& os) const;
+    };
+
+    inline
+    ProfileStore::ProfileStore(const std::string& directory, const index_t genomesNumber)
+    : fd_(-1), end_(0), pageSize_(static_cast<std::size_t>(sysconf(_SC_PAGESIZE))),
+    regions_(genomesNumber, Region{false, 0, 0, std::vector<index_t>(), nullptr}), written_(0), maps_(0) {
+        std::string path = directory + "/pandelos-profiles-XXXXXX";
+        std::vector<char> name(path.begin(), path.end());
+        name.push_back('\0');
+
+        fd_ = mkstemp(name.data());
+        if(fd_ < 0)
+            fail("spill file " + path);
+        // il file resta accessibile dal descrittore fino alla chiusura
+        unlink(name.data());
+    }
+
+    inline
+    ProfileStore::~ProfileStore() {
+        for(auto region = regions_.begin(); region != regions_.end(); ++region)
+            if(region->mapping != nullptr)
+                munmap(region->mapping, region->bytes);
+        close(fd_);
+    }
+
+    inline void
+    ProfileStore::fail(const std::string& what) {
+        throw std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    inline bool
+    ProfileStore::contains(genome_tr genome) const {
+        return regions_[genome.getId()].stored;
+    }
+
+    inline void
+    ProfileStore::spill(genome_tr genome, const k_t k) {
+        Region& region = regions_[genome.getId()];
+        // le regioni iniziano a inizio pagina, come richiesto da mmap
+        region.offset = (end_ + pageSize_ - 1) / pageSize_ * pageSize_;
+        region.bytes = 0;
+        region.sizes.clear();
+
+        off_t offset = region.offset;
+        auto& genes = genome.getGenes();
+        for(auto gene = genes.begin(); gene != genes.end(); ++gene) {
+            kmers::KmersView kmers = gene->getKmerContainer()->getKmerSet();
+            region.sizes.push_back(kmers.size());
+
+            const char* data = reinterpret_cast<const char*>(kmers.begin());
+            std::size_t remaining = kmers.size() * sizeof(kmer_t);
+            while(remaining > 0) {
+                ssize_t done = pwrite(fd_, data, remaining, offset);
+                if(done < 0) {
+                    if(errno == EINTR)
+                        continue;
+                    fail("spill file write");
+                }
+                data += done;
+                offset += done;
+                remaining -= done;
+            }
+        }
+
+        region.bytes = offset - region.offset;
+        region.stored = true;
+        end_ = offset;
+        written_ += region.bytes;
+
+        map(genome, k);
+    }
+
+    inline void
+    ProfileStore::map(genome_tr genome, const k_t k) {
+        Region& region = regions_[genome.getId()];
+        const kmer_t* kmers = nullptr;
+
+        if(region.bytes > 0) {
+            region.mapping = mmap(nullptr, region.bytes, PROT_READ, MAP_SHARED, fd_, region.offset);
+            if(region.mapping == MAP_FAILED) {
+                region.mapping = nullptr;
+                fail("spill file mmap");
+            }
+            // la regione viene letta in anticipo, in modo sequenziale
+            madvise(region.mapping, region.bytes, MADV_WILLNEED);
+            kmers = static_cast<const kmer_t*>(region.mapping);
+        }
+        ++maps_;
+
+        auto& genes = genome.getGenes();
+        auto size = region.sizes.begin();
+        for(auto gene = genes.begin(); gene != genes.end(); ++gene, ++size) {
+            gene->attachKmers(k, kmers, *size);
+            kmers += *size;
+        }
+    }
+
+    inline void
+    ProfileStore::unmap(genome_tr genome, thread_ptr pool) {
+        Region& region = regions_[genome.getId()];
+        genome.deleteAllKmers(pool);
+        if(region.mapping != nullptr) {
+            munmap(region.mapping, region.bytes);
+            region.mapping = nullptr;
+        }
+    }
+
+    inline void
+    ProfileStore::print(std::ostream& os) const {
+        os<<"spilled: "<<written_ / (1024 * 1024)<<" MiB, mappings: "<<maps_;
+    }
+
+}
+
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef DENSE_KMERS_PROFILE_INCLUDE_GUARD
+#define DENSE_KMERS_PROFILE_INCLUDE_GUARD 1
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "KmersContainer.hh"
+#include "../VariablesTypes.hh"
+
+
+/**
+ * @file DenseKmersProfile.hh
+ * @brief Definitions for the DenseKmersProfile class.
+ */
+
+ /**
+  * @namespace kmers
+  * @brief Namespace containing definitions for kmer related classes.
+  */
+namespace kmers {
+
+    /**
+     * @class DenseKmersProfile
+     * @brief Direct-addressed array kmer id -> multiplicity holding the profile of one gene.
+     *
+     * The profile of a row gene is scattered once, then every column gene is scored by reading
+     * the multiplicity of each of its kmers (gather) instead of merging the two sorted dictionaries.
+     * The array is sized to the kmer vocabulary and only the entries of the scattered gene are
+     * reset, so a new gene costs its number of distinct kmers and not the vocabulary size.
+     */
+    class DenseKmersProfile {
+
+    private:
+        using index_t = shared::indexType;
+        // la molteplicita' di un kmer in un gene sta in 32 bit, l'array occupa la meta'
+        using multiplicity_t = std::uint32_t;
+        using values_t = std::vector<multiplicity_t>;
+        using kmersContainer_tp = const KmersContainer*;
+
+        values_t values_;
+        kmersContainer_tp scattered_;
+
+    public:
+
+        /**
+         * @brief Constructs an empty profile, reserve must be called before scatter.
+         */
+        inline DenseKmersProfile() noexcept;
+
+        DenseKmersProfile(const DenseKmersProfile& other) = delete;
+        DenseKmersProfile(DenseKmersProfile&& other) = delete;
+        DenseKmersProfile& operator=(const DenseKmersProfile& other) = delete;
+        DenseKmersProfile& operator=(DenseKmersProfile&& other) = delete;
+
+        /**
+         * @brief Grows the array to vocabularySize entries, the array never shrinks.
+         *
+         * @param vocabularySize Greatest kmer id + 1.
+         */
+        inline void reserve(const index_t vocabularySize);
+
+        /**
+         * @brief Resets the previous gene and writes the multiplicities of container.
+         *
+         * @param container The kmers of the gene, every id must be lower than the reserved size.
+         */
+        inline void scatter(const KmersContainer& container) noexcept;
+
+        /**
+         * @brief Sets back to 0 the entries of the scattered gene.
+         */
+        inline void reset() noexcept;
+
+        /**
+         * @brief Retrieves the multiplicity of a kmer in the scattered gene.
+         *
+         * @param key The kmer id, lower than the reserved size.
+         * @return The multiplicity, 0 if the kmer is not in the gene.
+         */
+        inline std::size_t getMultiplicity(const index_t key) const noexcept;
+
+        /**
+         * @brief Retrieves the size of the array.
+         *
+         * @return The number of kmer ids that can be addressed.
+         */
+        inline index_t getCapacity() const noexcept;
+
+        inline ~DenseKmersProfile() = default;
+    };
+
+    inline
+        DenseKmersProfile::DenseKmersProfile() noexcept : scattered_(nullptr) {}
+
+    inline void
+        DenseKmersProfile::reserve(const index_t vocabularySize) {
+        if (vocabularySize > values_.size())
+            values_.resize(vocabularySize, 0);
+    }
+
+    inline void
+        DenseKmersProfile::scatter(const KmersContainer& container) noexcept {
+        reset();
+
+        const auto& kmers = container.getKmerSet();
+        for (auto kmer = kmers.begin(); kmer != kmers.end(); ++kmer)
+            values_[kmer->first] = static_cast<multiplicity_t>(kmer->second);
+
+        scattered_ = &container;
+    }
+
+    inline void
+        DenseKmersProfile::reset() noexcept {
+        if (scattered_ == nullptr)
+            return;
+
+        const auto& kmers = scattered_->getKmerSet();
+        for (auto kmer = kmers.begin(); kmer != kmers.end(); ++kmer)
+            values_[kmer->first] = 0;
+
+        scattered_ = nullptr;
+    }
+
+    inline std::size_t
+        DenseKmersProfile::getMultiplicity(const index_t key) const noexcept {
+        return values_[key];
+    }
+
+    inline DenseKmersProfile::index_t
+        DenseKmersProfile::getCapacity() const noexcept {
+        return values_.size();
+    }
+
+}
+
+
+#endif
@@ -2,6 +2,9 @@
 #define KMER_MAPPER_INCLUDE_GUARD 1
 
 #include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <utility>
 #include <iostream>
 #include <ext/pb_ds/assoc_container.hpp>
 #include <ext/pb_ds/hash_policy.hpp>
@@ -23,15 +26,38 @@ namespace kmers {
      * @brief Class for mapping kmers to indices.
      *
      * This class maps kmers (substrings) to unique indices.
+     * Kmers packed in integers (see PackedKmer) are mapped by key: 16 bit keys are
+     * direct-addressed, 32 and 64 bit keys use integer hash tables.
      */
     class KmerMapper {
     private:
+        // i kmer impacchettati hanno un residuo per byte: i bit bassi variano poco,
+        // vanno mescolati prima di usare la maschera della tabella (fmix64 di MurmurHash3)
+        struct PackedHash {
+            inline std::size_t operator()(std::uint64_t key) const noexcept {
+                key ^= key >> 33;
+                key *= 0xff51afd7ed558ccdULL;
+                key ^= key >> 33;
+                key *= 0xc4ceb9fe1a85ec53ULL;
+                key ^= key >> 33;
+                return static_cast<std::size_t>(key);
+            }
+        };
+
         using index_t = shared::indexType;
         using subsequence_t = shared::subSequenceType;
         using subsequence_tr = subsequence_t&;
         using map_t = __gnu_pbds::gp_hash_table<subsequence_t, index_t>;
+        using directMap_t = std::vector<index_t>;
+        using map32_t = __gnu_pbds::gp_hash_table<std::uint32_t, index_t, PackedHash>;
+        using map64_t = __gnu_pbds::gp_hash_table<std::uint64_t, index_t, PackedHash>;
         index_t nextIndex_;
         map_t map_;
+        // kmer impacchettati, usati solo se k e' noto a tempo di compilazione
+        directMap_t directMap_;
+        index_t directMapSize_;
+        map32_t map32_;
+        map64_t map64_;
 
     public:
         /**
@@ -53,6 +79,16 @@ namespace kmers {
 
         inline index_t mapAndGetIndex(const subsequence_tr str) noexcept;
 
+        /**
+         * @brief Maps a packed kmer to an index.
+         *
+         * @param key The key of the kmer (see PackedKmer).
+         * @return The index associated with the kmer.
+         */
+        inline index_t mapPackedAndGetIndex(const std::uint16_t key);
+        inline index_t mapPackedAndGetIndex(const std::uint32_t key);
+        inline index_t mapPackedAndGetIndex(const std::uint64_t key);
+
 #ifdef DEV_MODE
         /**
          * @brief Prints the mapping to an output stream.
@@ -68,6 +104,13 @@ namespace kmers {
          */
         inline size_t size() const noexcept;
 
+        /**
+         * @brief Estimates the memory used by the mapping: the hash tables are kept at most half full.
+         *
+         * @return The number of bytes.
+         */
+        inline std::size_t getMemoryUsage() const noexcept;
+
         /**
          * @brief Default destructor.
          */
@@ -77,7 +120,7 @@ namespace kmers {
     /**
      * @brief Default constructor implementation.
      */
-    inline KmerMapper::KmerMapper() noexcept : nextIndex_(0) {
+    inline KmerMapper::KmerMapper() noexcept : nextIndex_(0), directMapSize_(0) {
 #ifdef xTOR_DEBUG
         std::cerr << "\nCtor KmerMapper::KmerMapper";
 #endif
@@ -106,6 +149,43 @@ namespace kmers {
         return ret;
     }
 
+    inline KmerMapper::index_t
+        KmerMapper::mapPackedAndGetIndex(const std::uint16_t key) {
+        // -1 indica le chiavi non ancora viste
+        if (directMap_.empty())
+            directMap_.assign(UINT16_MAX + 1, static_cast<index_t>(-1));
+
+        index_t& index = directMap_[key];
+        if (index == static_cast<index_t>(-1)) {
+            index = nextIndex_;
+            ++nextIndex_;
+            ++directMapSize_;
+        }
+        return index;
+    }
+
+    inline KmerMapper::index_t
+        KmerMapper::mapPackedAndGetIndex(const std::uint32_t key) {
+        auto elem = map32_.find(key);
+        if (elem != map32_.end())
+            return elem->second;
+        map32_.insert(std::make_pair(key, nextIndex_));
+        index_t ret = nextIndex_;
+        ++nextIndex_;
+        return ret;
+    }
+
+    inline KmerMapper::index_t
+        KmerMapper::mapPackedAndGetIndex(const std::uint64_t key) {
+        auto elem = map64_.find(key);
+        if (elem != map64_.end())
+            return elem->second;
+        map64_.insert(std::make_pair(key, nextIndex_));
+        index_t ret = nextIndex_;
+        ++nextIndex_;
+        return ret;
+    }
+
 #ifdef DEV_MODE
     /**
      * @brief Prints the mapping to an output stream.
@@ -127,7 +207,20 @@ namespace kmers {
      */
     inline size_t
         KmerMapper::size() const noexcept {
-        return map_.size();
+        return map_.size() + directMapSize_ + map32_.size() + map64_.size();
+    }
+
+    inline std::size_t
+        KmerMapper::getMemoryUsage() const noexcept {
+        // ogni cella contiene la coppia e il suo stato, le celle sono almeno il doppio degli elementi
+        std::size_t bytes = directMap_.capacity() * sizeof(index_t);
+        bytes += 2 * map_.size() * (sizeof(std::pair<subsequence_t, index_t>) + sizeof(std::size_t));
+        bytes += 2 * map32_.size() * (sizeof(std::pair<std::uint32_t, index_t>) + sizeof(std::size_t));
+        bytes += 2 * map64_.size() * (sizeof(std::pair<std::uint64_t, index_t>) + sizeof(std::size_t));
+        // i kmer piu' lunghi del buffer interno delle stringhe sono allocati a parte, tutti della stessa lunghezza
+        if (!map_.empty() && map_.begin()->first.capacity() > subsequence_t().capacity())
+            bytes += map_.size() * (map_.begin()->first.capacity() + 1);
+        return bytes;
     }
 }
 
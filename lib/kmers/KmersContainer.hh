@@ -5,8 +5,12 @@
 #include <iostream>
 #include <cstddef>
 #include <map>
+#include <vector>
+#include <algorithm>
 
 #include "KmerMapper.hh"
+#include "PackedKmer.hh"
+#include "KmersView.hh"
 #include "../VariablesTypes.hh"
 
 
@@ -37,8 +41,7 @@ namespace kmers {
         using mapKey_t = index_t;
 
         using k_dictionary_tmp = std::map<mapKey_t, multipicity_t>;
-        using k_dictionary_t = std::vector<std::pair<mapKey_t, multipicity_t>>;
-        using kmerSet_t = k_dictionary_t;
+        using k_dictionary_t = std::vector<KmersView::value_type>;
 
         k_t k_;
         sequence_t alphabet_;
@@ -49,13 +52,16 @@ namespace kmers {
 
         // Set of kmers
         k_dictionary_t dictionary_;
+        // kmer esterni (file mappato) usati al posto del dizionario, nullptr se non presenti
+        const KmersView::value_type* attached_;
         mapKey_t smallerKey_;
         mapKey_t biggerKey_;
         multipicity_t smallerMultip_;
         multipicity_t biggerMultip_;
 
     public:
-        using kmerSet_tr = const kmerSet_t&;
+        using kmerSet_tr = KmersView;
+        using kmer_t = KmersView::value_type;
 
         /**
          * @brief Deleted default constructor.
@@ -108,9 +114,9 @@ namespace kmers {
 
 
         /**
-         * @brief Retrieves the set of kmers stored in the container.
+         * @brief Retrieves the set of kmers stored in the container, or attached to it.
          *
-         * @return Constant reference to the set of kmers.
+         * @return A view of the set of kmers, valid until the kmers change.
          */
         inline kmerSet_tr getKmerSet() const noexcept;
 
@@ -142,6 +148,23 @@ namespace kmers {
          */
         inline index_t getMultiplicityNumber() const noexcept;
 
+        /**
+         * @brief Retrieves the memory used by the container, the alphabet copy and the kmers included.
+         * The attached kmers are included too, as they are read in memory when used.
+         *
+         * @return Number of bytes.
+         */
+        inline std::size_t getMemoryUsage() const noexcept;
+
+        /**
+         * @brief Uses kmers stored outside the container instead of the own dictionary, which is released.
+         *
+         * @param kmers The kmers sorted by id, produced by calculateKmers or calculatePackedKmers with the same
+         *        mapper; they must not change or be released while the container uses them.
+         * @param size The number of kmers.
+         */
+        inline void attach(const kmer_t* kmers, index_t size) noexcept;
+
 
         /**
          * @brief Calculates kmers for the container using a provided kmer mapper.
@@ -150,6 +173,16 @@ namespace kmers {
          */
         inline void calculateKmers(KmerMapper& mapper) noexcept;
 
+        /**
+         * @brief Calculates kmers for the container with the length of the kmers known at compile time.
+         * Kmers are packed in integers (see PackedKmer) and rolled one residue at a time,
+         * the ids are then sorted and counted. The result is the same of calculateKmers.
+         * @tparam K The length of the kmers, must be equal to the k of the container.
+         * @param mapper Reference to the kmer mapper.
+         */
+        template<k_t K>
+        inline void calculatePackedKmers(KmerMapper& mapper);
+
         /**
          * @brief Retrieves the alphabet used for generating kmers.
          *
@@ -200,12 +233,12 @@ namespace kmers {
     inline
         KmersContainer::KmersContainer(k_t k_length, const sequence_tr alphabet, std::size_t alphabetLength) noexcept
         : k_(k_length), alphabet_(alphabet), alphabetLength_(alphabetLength), multiplicityNumber_(alphabetLength - k_length + 1), kmersNumber_(0),
-        smallerKey_(0), biggerKey_(0), smallerMultip_(0), biggerMultip_(0) {}
+        attached_(nullptr), smallerKey_(0), biggerKey_(0), smallerMultip_(0), biggerMultip_(0) {}
 
     inline
         KmersContainer::KmersContainer(const KmersContainer& other) noexcept
         : k_(other.k_), alphabet_(other.alphabet_), alphabetLength_(other.alphabetLength_), multiplicityNumber_(other.multiplicityNumber_), kmersNumber_(other.kmersNumber_),
-        dictionary_(other.dictionary_), smallerKey_(other.smallerKey_), biggerKey_(other.biggerKey_), smallerMultip_(other.smallerMultip_), biggerMultip_(other.biggerMultip_) {}
+        dictionary_(other.dictionary_), attached_(other.attached_), smallerKey_(other.smallerKey_), biggerKey_(other.biggerKey_), smallerMultip_(other.smallerMultip_), biggerMultip_(other.biggerMultip_) {}
 
     inline KmersContainer
         & KmersContainer::operator=(const KmersContainer& other) noexcept {
@@ -216,6 +249,7 @@ namespace kmers {
             multiplicityNumber_ = other.multiplicityNumber_;
             kmersNumber_ = other.kmersNumber_;
             dictionary_ = other.dictionary_;
+            attached_ = other.attached_;
             smallerKey_ = other.smallerKey_;
             biggerKey_ = other.biggerKey_;
             smallerMultip_ = other.smallerMultip_;
@@ -227,7 +261,7 @@ namespace kmers {
     inline
         KmersContainer::KmersContainer(KmersContainer&& other) noexcept
         : k_(other.k_), alphabet_(std::move(other.alphabet_)), alphabetLength_(other.alphabetLength_), multiplicityNumber_(other.multiplicityNumber_), kmersNumber_(other.kmersNumber_),
-        dictionary_(std::move(other.dictionary_)), smallerKey_(other.smallerKey_), biggerKey_(other.biggerKey_), smallerMultip_(other.smallerMultip_), biggerMultip_(other.biggerMultip_) {}
+        dictionary_(std::move(other.dictionary_)), attached_(other.attached_), smallerKey_(other.smallerKey_), biggerKey_(other.biggerKey_), smallerMultip_(other.smallerMultip_), biggerMultip_(other.biggerMultip_) {}
 
     inline KmersContainer&
         KmersContainer::operator=(KmersContainer&& other) noexcept {
@@ -237,6 +271,7 @@ namespace kmers {
             alphabetLength_ = other.alphabetLength_;
             multiplicityNumber_ = other.multiplicityNumber_;
             dictionary_ = std::move(other.dictionary_);
+            attached_ = other.attached_;
             smallerKey_ = other.smallerKey_;
             kmersNumber_ = other.kmersNumber_;
             biggerKey_ = other.biggerKey_;
@@ -307,6 +342,42 @@ namespace kmers {
     }
 
 
+    template<KmersContainer::k_t K>
+    inline void
+        KmersContainer::calculatePackedKmers(KmerMapper& mapper) {
+        using packed_t = PackedKmer<K>;
+
+        if (alphabetLength_ < K)
+            return;
+
+        std::vector<mapKey_t> ids;
+        ids.reserve(multiplicityNumber_);
+
+        const char* residues = alphabet_.data();
+        typename packed_t::key_t key = packed_t::encode(residues);
+        ids.push_back(mapper.mapPackedAndGetIndex(key));
+        for (index_t i = 1; i < multiplicityNumber_; ++i) {
+            key = packed_t::roll(key, residues[i + K - 1]);
+            ids.push_back(mapper.mapPackedAndGetIndex(key));
+        }
+
+        // ordinati gli id, le molteplicita' sono le lunghezze delle sequenze di id uguali
+        std::sort(ids.begin(), ids.end());
+        for (auto id = ids.begin(); id != ids.end(); ++id) {
+            if (dictionary_.empty() || dictionary_.back().first != *id)
+                dictionary_.push_back(std::make_pair(*id, 1));
+            else
+                ++dictionary_.back().second;
+        }
+
+        kmersNumber_ = dictionary_.size();
+        smallerKey_ = dictionary_.front().first;
+        biggerKey_ = dictionary_.back().first;
+        smallerMultip_ = dictionary_.front().second;
+        biggerMultip_ = dictionary_.back().second;
+    }
+
+
     // inline void
     // KmersContainer::deleteDictionary(){
     //     dictionary_.clear();
@@ -316,7 +387,23 @@ namespace kmers {
 
     inline KmersContainer::kmerSet_tr
         KmersContainer::getKmerSet() const noexcept {
-        return dictionary_;
+        if (attached_ != nullptr)
+            return KmersView(attached_, kmersNumber_);
+        return KmersView(dictionary_.data(), dictionary_.size());
+    }
+
+    inline void
+        KmersContainer::attach(const kmer_t* kmers, index_t size) noexcept {
+        k_dictionary_t().swap(dictionary_);
+        attached_ = kmers;
+        kmersNumber_ = size;
+        if (size == 0)
+            return;
+
+        smallerKey_ = kmers[0].first;
+        biggerKey_ = kmers[size - 1].first;
+        smallerMultip_ = kmers[0].second;
+        biggerMultip_ = kmers[size - 1].second;
     }
 
 
@@ -329,6 +416,12 @@ namespace kmers {
         KmersContainer::getMultiplicityNumber() const noexcept {
         return multiplicityNumber_;
     }
+
+    inline std::size_t
+        KmersContainer::getMemoryUsage() const noexcept {
+        index_t kmers = attached_ != nullptr ? kmersNumber_ : dictionary_.capacity();
+        return sizeof(KmersContainer) + alphabet_.capacity() + kmers * sizeof(kmer_t);
+    }
     inline KmersContainer::sequence_t
         KmersContainer::getAlphabet() const noexcept {
         return alphabet_;
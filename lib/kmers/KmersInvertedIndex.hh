@@ -0,0 +1,325 @@
+#ifndef KMERS_INVERTED_INDEX_INCLUDE_GUARD
+#define KMERS_INVERTED_INDEX_INCLUDE_GUARD 1
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "KmersContainer.hh"
+#include "../VariablesTypes.hh"
+
+
+/**
+ * @file KmersInvertedIndex.hh
+ * @brief Definitions for the KmersInvertedIndex and PostingsAccumulator classes.
+ */
+
+ /**
+  * @namespace kmers
+  * @brief Namespace containing definitions for kmer related classes.
+  */
+namespace kmers {
+
+    /**
+     * @class KmersInvertedIndex
+     * @brief Inverted index kmer id -> (gene, multiplicity) of the genes of a genome.
+     *
+     * The postings are stored contiguously (CSR): the postings of kmer id are in
+     * [offsets_[id], offsets_[id + 1]), sorted by gene index.
+     */
+    class KmersInvertedIndex {
+
+    private:
+        using index_t = shared::indexType;
+        using offsets_t = std::vector<std::uint32_t>;
+
+    public:
+        /**
+         * @brief A gene containing a kmer and the multiplicity of the kmer in that gene.
+         */
+        struct Posting {
+            std::uint32_t gene;
+            std::uint32_t multiplicity;
+        };
+
+    private:
+        using postings_t = std::vector<Posting>;
+
+        offsets_t offsets_;
+        postings_t postings_;
+        bool built_;
+
+    public:
+        /**
+         * @brief Constructs an empty index.
+         */
+        inline KmersInvertedIndex() noexcept;
+
+        KmersInvertedIndex(const KmersInvertedIndex& other) = delete;
+        KmersInvertedIndex(KmersInvertedIndex&& other) = delete;
+        KmersInvertedIndex& operator=(const KmersInvertedIndex& other) = delete;
+        KmersInvertedIndex& operator=(KmersInvertedIndex&& other) = delete;
+
+        /**
+         * @brief Builds the index of the genes, the previous content is discarded and its storage reused.
+         *
+         * @tparam Genes A container of genes with getKmerContainer().
+         * @param genes The genes, the position in genes is the gene index of the postings.
+         * @param vocabularySize Greatest kmer id of the genes + 1.
+         */
+        template<typename Genes>
+        inline void build(const Genes& genes, const index_t vocabularySize);
+
+        /**
+         * @brief Marks the index as not built, the storage is kept for the next build.
+         */
+        inline void reset() noexcept;
+
+        /**
+         * @brief Checks if build has been called.
+         *
+         * @return True if the index is built.
+         */
+        inline bool isBuilt() const noexcept;
+
+        /**
+         * @brief Retrieves the first posting of a kmer.
+         *
+         * @param key The kmer id.
+         * @return Pointer to the first posting, equal to getPostingsEnd(key) if no gene contains the kmer.
+         */
+        inline const Posting* getPostingsBegin(const index_t key) const noexcept;
+
+        /**
+         * @brief Retrieves the end of the postings of a kmer.
+         *
+         * @param key The kmer id.
+         * @return Pointer past the last posting.
+         */
+        inline const Posting* getPostingsEnd(const index_t key) const noexcept;
+
+        /**
+         * @brief Retrieves the number of kmer ids addressed by the index.
+         *
+         * @return Greatest kmer id + 1.
+         */
+        inline index_t getVocabularySize() const noexcept;
+
+        inline ~KmersInvertedIndex() = default;
+    };
+
+    /**
+     * @class PostingsAccumulator
+     * @brief Accumulates, for every gene of a KmersInvertedIndex, the intersection with one query gene.
+     *
+     * For each indexed gene it keeps the sums of the minima and of the maxima of the shared kmers and the
+     * multiplicities of the shared kmers in the query and in the indexed gene: the same quantities computed
+     * by the merge of two dictionaries. Only the touched genes are reset.
+     */
+    class PostingsAccumulator {
+
+    private:
+        using index_t = shared::indexType;
+        using values_t = std::vector<std::uint32_t>;
+        using touched_t = std::vector<index_t>;
+
+        values_t num_;
+        values_t den_;
+        values_t queryShared_;
+        values_t geneShared_;
+        touched_t touched_;
+
+    public:
+        /**
+         * @brief Constructs an empty accumulator, reserve must be called before accumulate.
+         */
+        inline PostingsAccumulator() noexcept = default;
+
+        PostingsAccumulator(const PostingsAccumulator& other) = delete;
+        PostingsAccumulator(PostingsAccumulator&& other) = delete;
+        PostingsAccumulator& operator=(const PostingsAccumulator& other) = delete;
+        PostingsAccumulator& operator=(PostingsAccumulator&& other) = delete;
+
+        /**
+         * @brief Grows the accumulator to genesNumber genes, it never shrinks.
+         *
+         * @param genesNumber Number of genes of the index.
+         */
+        inline void reserve(const index_t genesNumber);
+
+        /**
+         * @brief Resets the previous query and accumulates the intersections of query with every indexed gene.
+         *
+         * @param query The kmers of the query gene.
+         * @param index The inverted index.
+         */
+        inline void accumulate(const KmersContainer& query, const KmersInvertedIndex& index) noexcept;
+
+        /**
+         * @brief Sets back to 0 the touched genes.
+         */
+        inline void reset() noexcept;
+
+        /**
+         * @brief Sum of the minima of the shared kmers.
+         * @param gene The indexed gene.
+         */
+        inline std::size_t getNum(const index_t gene) const noexcept;
+
+        /**
+         * @brief Sum of the maxima of the shared kmers.
+         * @param gene The indexed gene.
+         */
+        inline std::size_t getDen(const index_t gene) const noexcept;
+
+        /**
+         * @brief Multiplicity of the shared kmers in the query gene.
+         * @param gene The indexed gene.
+         */
+        inline std::size_t getQueryShared(const index_t gene) const noexcept;
+
+        /**
+         * @brief Multiplicity of the shared kmers in the indexed gene.
+         * @param gene The indexed gene.
+         */
+        inline std::size_t getGeneShared(const index_t gene) const noexcept;
+
+        inline ~PostingsAccumulator() = default;
+    };
+
+    inline
+        KmersInvertedIndex::KmersInvertedIndex() noexcept : built_(false) {}
+
+    template<typename Genes>
+    inline void
+        KmersInvertedIndex::build(const Genes& genes, const index_t vocabularySize) {
+        offsets_.assign(vocabularySize + 1, 0);
+
+        // conteggio dei geni per kmer, poi somma prefissa
+        for (auto gene = genes.begin(); gene != genes.end(); ++gene) {
+            const auto& kmers = gene->getKmerContainer()->getKmerSet();
+            for (auto kmer = kmers.begin(); kmer != kmers.end(); ++kmer)
+                ++offsets_[kmer->first + 1];
+        }
+        for (index_t key = 0; key < vocabularySize; ++key)
+            offsets_[key + 1] += offsets_[key];
+
+        postings_.resize(offsets_[vocabularySize]);
+
+        // i geni sono visitati in ordine, le posting di ogni kmer restano ordinate per gene;
+        // offsets_[id] fa da cursore e alla fine vale l'inizio del kmer successivo
+        std::uint32_t geneIndex = 0;
+        for (auto gene = genes.begin(); gene != genes.end(); ++gene, ++geneIndex) {
+            const auto& kmers = gene->getKmerContainer()->getKmerSet();
+            for (auto kmer = kmers.begin(); kmer != kmers.end(); ++kmer) {
+                Posting& posting = postings_[offsets_[kmer->first]++];
+                posting.gene = geneIndex;
+                posting.multiplicity = static_cast<std::uint32_t>(kmer->second);
+            }
+        }
+        // i cursori spostati di una posizione sono di nuovo gli inizi
+        for (index_t key = vocabularySize; key > 0; --key)
+            offsets_[key] = offsets_[key - 1];
+        offsets_[0] = 0;
+
+        built_ = true;
+    }
+
+    inline void
+        KmersInvertedIndex::reset() noexcept {
+        built_ = false;
+    }
+
+    inline bool
+        KmersInvertedIndex::isBuilt() const noexcept {
+        return built_;
+    }
+
+    inline const KmersInvertedIndex::Posting*
+        KmersInvertedIndex::getPostingsBegin(const index_t key) const noexcept {
+        return postings_.data() + offsets_[key];
+    }
+
+    inline const KmersInvertedIndex::Posting*
+        KmersInvertedIndex::getPostingsEnd(const index_t key) const noexcept {
+        return postings_.data() + offsets_[key + 1];
+    }
+
+    inline KmersInvertedIndex::index_t
+        KmersInvertedIndex::getVocabularySize() const noexcept {
+        return offsets_.empty() ? 0 : offsets_.size() - 1;
+    }
+
+    inline void
+        PostingsAccumulator::reserve(const index_t genesNumber) {
+        if (genesNumber > num_.size()) {
+            num_.resize(genesNumber, 0);
+            den_.resize(genesNumber, 0);
+            queryShared_.resize(genesNumber, 0);
+            geneShared_.resize(genesNumber, 0);
+        }
+    }
+
+    inline void
+        PostingsAccumulator::accumulate(const KmersContainer& query, const KmersInvertedIndex& index) noexcept {
+        reset();
+
+        const index_t vocabularySize = index.getVocabularySize();
+        const auto& kmers = query.getKmerSet();
+        for (auto kmer = kmers.begin(); kmer != kmers.end(); ++kmer) {
+            if (kmer->first >= vocabularySize)
+                continue;
+
+            const std::uint32_t queryVal = static_cast<std::uint32_t>(kmer->second);
+            const KmersInvertedIndex::Posting* end = index.getPostingsEnd(kmer->first);
+            for (const KmersInvertedIndex::Posting* posting = index.getPostingsBegin(kmer->first); posting != end; ++posting) {
+                const index_t gene = posting->gene;
+                const std::uint32_t geneVal = posting->multiplicity;
+
+                // geneShared_ e' 0 solo per i geni non ancora toccati
+                if (geneShared_[gene] == 0)
+                    touched_.push_back(gene);
+
+                num_[gene] += queryVal < geneVal ? queryVal : geneVal;
+                den_[gene] += queryVal < geneVal ? geneVal : queryVal;
+                queryShared_[gene] += queryVal;
+                geneShared_[gene] += geneVal;
+            }
+        }
+    }
+
+    inline void
+        PostingsAccumulator::reset() noexcept {
+        for (auto gene = touched_.begin(); gene != touched_.end(); ++gene) {
+            num_[*gene] = 0;
+            den_[*gene] = 0;
+            queryShared_[*gene] = 0;
+            geneShared_[*gene] = 0;
+        }
+        touched_.clear();
+    }
+
+    inline std::size_t
+        PostingsAccumulator::getNum(const index_t gene) const noexcept {
+        return num_[gene];
+    }
+
+    inline std::size_t
+        PostingsAccumulator::getDen(const index_t gene) const noexcept {
+        return den_[gene];
+    }
+
+    inline std::size_t
+        PostingsAccumulator::getQueryShared(const index_t gene) const noexcept {
+        return queryShared_[gene];
+    }
+
+    inline std::size_t
+        PostingsAccumulator::getGeneShared(const index_t gene) const noexcept {
+        return geneShared_[gene];
+    }
+
+}
+
+
+#endif
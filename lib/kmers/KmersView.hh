@@ -0,0 +1,80 @@
+#ifndef KMERS_VIEW_INCLUDE_GUARD
+#define KMERS_VIEW_INCLUDE_GUARD 1
+
+#include <cstddef>
+#include <utility>
+
+#include "../VariablesTypes.hh"
+
+
+/**
+ * @file KmersView.hh
+ * @brief Definitions for the KmersView class.
+ */
+
+ /**
+  * @namespace kmers
+  * @brief Namespace containing definitions for kmer related classes.
+  */
+namespace kmers {
+
+    /**
+     * @class KmersView
+     * @brief A read only range of kmers (id, multiplicity) sorted by id, without ownership.
+     *
+     * The kmers may be in the dictionary of a KmersContainer or in a mapped spill file (see
+     * genome::ProfileStore): the similarity kernels read both in the same way.
+     */
+    class KmersView {
+    public:
+        using value_type = std::pair<shared::indexType, shared::multiplicityType>;
+        using const_iterator = const value_type*;
+        using size_type = std::size_t;
+
+    private:
+        const_iterator begin_;
+        size_type size_;
+
+    public:
+        /**
+         * @brief Constructs a view of size kmers starting from begin.
+         *
+         * @param begin The first kmer.
+         * @param size The number of kmers.
+         */
+        inline KmersView(const_iterator begin, size_type size) noexcept
+            : begin_(begin), size_(size) {}
+
+        inline const_iterator begin() const noexcept {
+            return begin_;
+        }
+
+        inline const_iterator end() const noexcept {
+            return begin_ + size_;
+        }
+
+        inline size_type size() const noexcept {
+            return size_;
+        }
+
+        inline bool empty() const noexcept {
+            return size_ == 0;
+        }
+
+        inline const value_type& operator[](size_type index) const noexcept {
+            return begin_[index];
+        }
+
+        inline const value_type& front() const noexcept {
+            return begin_[0];
+        }
+
+        inline const value_type& back() const noexcept {
+            return begin_[size_ - 1];
+        }
+    };
+
+}
+
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef PACKED_KMER_INCLUDE_GUARD
+#define PACKED_KMER_INCLUDE_GUARD 1
+
+#include <cstdint>
+#include <type_traits>
+
+#include "../VariablesTypes.hh"
+
+
+/**
+ * @file PackedKmer.hh
+ * @brief Definitions for the PackedKmer class template.
+ */
+
+ /**
+  * @namespace kmers
+  * @brief Namespace containing definitions for kmer related classes.
+  */
+namespace kmers {
+
+    /**
+     * @class PackedKmer
+     * @brief Encodes a kmer of length K known at compile time in an integer, one byte per residue.
+     *
+     * The key type is the narrowest unsigned integer that holds K bytes (16 bit up to k = 2,
+     * 32 bit up to k = 4, 64 bit up to k = 8). The encoding of the first kmer is unrolled by the
+     * compiler, the following ones are obtained by rolling one residue at a time.
+     *
+     * @tparam K The length of the kmers (1 <= K <= 8, 0 is accepted only to instantiate unused code).
+     */
+    template<shared::kType K>
+    class PackedKmer {
+        static_assert(K <= 8, "a packed kmer holds at most 8 residues");
+
+    public:
+        using key_t = typename std::conditional<
+            (K <= 2), std::uint16_t,
+            typename std::conditional<(K <= 4), std::uint32_t, std::uint64_t>::type
+        >::type;
+
+    private:
+        static constexpr unsigned bits_ = 8 * K;
+        static constexpr unsigned keyBits_ = 8 * sizeof(key_t);
+
+        // i residui usciti dalla finestra vengono tolti dalla maschera
+        static constexpr key_t mask_ = bits_ >= keyBits_ ? static_cast<key_t>(~key_t(0)) : static_cast<key_t>((key_t(1) << (bits_ % keyBits_)) - 1);
+
+        template<shared::kType I, typename Dummy = void>
+        struct Unroll {
+            static inline key_t encode(const char* residues, const key_t key) noexcept {
+                return Unroll<I - 1>::encode(residues + 1, static_cast<key_t>((key << 8) | static_cast<unsigned char>(*residues)));
+            }
+        };
+
+        template<typename Dummy>
+        struct Unroll<0, Dummy> {
+            static inline key_t encode(const char*, const key_t key) noexcept {
+                return key;
+            }
+        };
+
+    public:
+        PackedKmer() = delete;
+
+        /**
+         * @brief Encodes the K residues starting at residues.
+         *
+         * @param residues Pointer to the first residue.
+         * @return The key of the kmer.
+         */
+        static inline key_t encode(const char* residues) noexcept {
+            return Unroll<K>::encode(residues, 0);
+        }
+
+        /**
+         * @brief Drops the first residue of the kmer and appends residue.
+         *
+         * @param key The key of the previous kmer.
+         * @param residue The residue following the previous kmer.
+         * @return The key of the next kmer.
+         */
+        static inline key_t roll(const key_t key, const char residue) noexcept {
+            return static_cast<key_t>(((key << 8) | static_cast<unsigned char>(residue)) & mask_);
+        }
+    };
+
+}
+
+
+#endif
@@ -1,6 +1,13 @@
 #include <iostream>
 #include <unistd.h>
+#include <getopt.h>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <memory>
 #include <thread>
+#include <exception>
 
 #include "lib/Homology.hh"
 #include "lib/FragHomology.hh"
@@ -16,6 +23,43 @@ using namespace genome;
 using namespace utilities;
 
 
+/**
+ * @brief The options of a run, set by parser.
+ */
+struct Options {
+    // dimensione dei kmer, file e thread
+    int k = 1;
+    std::string inFile = "";
+    std::string outFile = "";
+    ushort threadNum = 0;
+    // modalita' con minor costo in ram, scarto e geni frammentati
+    bool mode = false;
+    float discard = 0.5;
+    bool frags = false;
+    // geni per lato di un tile (-1 automatico), kernel, motore e coppie contemporanee (0 automatico)
+    int tileSize = -1;
+    SimilarityKernel kernel = SimilarityKernel::automatic;
+    BBHEngine engine = BBHEngine::streaming;
+    int concurrentPairs = 0;
+    // byte di kmer tra una coppia e l'altra, genomi di un blocco (-1 nessun blocco, 0 automatico), cartella dello spill
+    std::size_t memBudget = 0;
+    int blockGenomes = -1;
+    std::string spillDir = "";
+    // secondi tra due checkpoint (-1 nessun checkpoint)
+    int checkpoint = -1;
+    bool resume = false;
+    // stato della run, stato precedente e cartella della cache delle coppie (vuoti nessuno)
+    std::string stateFile = "";
+    std::string addFile = "";
+    std::string pairCache = "";
+    // shard statico shardIndex su shardCount (0 nessuno), cartella dei lock, output degli shard da unire
+    int shardIndex = 0;
+    int shardCount = 0;
+    std::string shardDir = "";
+    std::vector<std::string> mergeFiles;
+};
+
+
 /**
  * @brief Prints the title.
  *
@@ -48,7 +92,22 @@ void printHelp() {
         << "-t per indicare il numero di thread\n"
         << "-m per attivare la modalità con un costo minore in ram (0 default)\n"
         << "-d per selezionare un valore di scarto (0 <= d <= 1) per il calcolo della similarità (0.5 default, un valore maggiore corrisponde a un scarto più aggressivo)\n";
-    << "-f per i geni frammentanti\n";
+    << "-f per i geni frammentanti (senza le opzioni lunghe, tranne --help)\n"
+    << "-T per indicare il numero di geni per lato di un tile (0 un task per riga, default calcolato dalla cache L2)\n"
+    << "-K per selezionare il kernel di similarità: merge, galloping, scatter, inverted o auto (default, scelto per ogni coppia di genomi)\n"
+    << "-E per selezionare il motore dei BBH: streaming (default, memoria lineare), sparse (solo punteggi non nulli) o matrix (matrice completa dei punteggi)\n"
+    << "-P per indicare il numero di coppie di genomi calcolate contemporaneamente (0 default: una per thread con il motore streaming, 1 con gli altri)\n"
+    << "--mem-budget per indicare la memoria dei kmer, e del loro vocabolario, mantenuti tra una coppia e l'altra con -m o --block-genomes, in MiB o con suffisso K, M, G (0 default, nessuna cache)\n"
+    << "--block-genomes per calcolare le coppie a blocchi di genomi mantenuti insieme in memoria (0 calcolato da --mem-budget o dalla memoria disponibile)\n"
+    << "--spill-dir per indicare la cartella (su disco locale) del file in cui -m e --block-genomes salvano i kmer calcolati, riletti invece di essere ricalcolati\n"
+    << "--checkpoint per salvare ogni quanti secondi le coppie di genomi completate in output.ckpt (0 dopo ogni coppia)\n"
+    << "--resume per riprendere un calcolo interrotto dal suo checkpoint (checkpoint ogni 60 secondi se non indicato, senza --state, --add e --pair-cache)\n"
+    << "--state per salvare i BBH e i minimi di ogni coppia di genomi nel file indicato, per aggiungere genomi in seguito\n"
+    << "--add per riusare le coppie del file di stato indicato, calcolando solo quelle con i genomi aggiunti (stato aggiornato nello stesso file se --state non e' indicato)\n"
+    << "--pair-cache per indicare la cartella in cui le esecuzioni condividono i BBH delle coppie di genomi gia' calcolate\n"
+    << "--shard i/N per calcolare solo la parte i (da 0 a N - 1) delle coppie di genomi diversi, minimi in output.min\n"
+    << "--shard-dir per calcolare i lotti di coppie di genomi diversi reclamati con file di lock nella cartella condivisa indicata, minimi in output.min\n"
+    << "--merge per indicare l'output di uno shard da unire (ripetuto per ogni shard): i minimi vengono ridotti e ogni genoma confrontato con se stesso\n";
 #else
     std::cout << "Usage:\n"
         << "-i to select the input file (path_to_file/file.faa)\n"
@@ -57,54 +116,197 @@ void printHelp() {
         << "-t to indicate the number of threads\n"
         << "-m to activate specific mode with lower RAM cost (0 default)\n"
         << "-d to select a discard value (0 <= d <= 1) for similarity computation (0.5 default, a grater value implies a more aggressive discard)\n"
-        << "-f for fragmented genes\n";
+        << "-f for fragmented genes (without the long options, except --help)\n"
+        << "-T to indicate the number of genes per side of a tile (0 one task per row, default computed from the L2 cache size)\n"
+        << "-K to select the similarity kernel: merge, galloping, scatter, inverted or auto (default, chosen for every genome pair)\n"
+        << "-E to select the BBH engine: streaming (default, linear memory), sparse (nonzero scores only) or matrix (full score matrix)\n"
+        << "-P to indicate the number of genome pairs computed at the same time (0 default: one per thread with the streaming engine, 1 with the others)\n"
+        << "--mem-budget to indicate the memory for the kmers, and their vocabulary, kept between genome pairs with -m or --block-genomes, in MiB or with a K, M, G suffix (0 default, no cache)\n"
+        << "--block-genomes to compute the pairs by blocks of genomes kept together in memory (0 derived from --mem-budget or from the available memory)\n"
+        << "--spill-dir to indicate the directory (on a local disk) of the file where -m and --block-genomes store the computed kmers, mapped again instead of computed again\n"
+        << "--checkpoint to save the completed genome pairs in output.ckpt every given number of seconds (0 after every pair)\n"
+        << "--resume to resume an interrupted run from its checkpoint (checkpoint every 60 seconds if not given, without --state, --add and --pair-cache)\n"
+        << "--state to save the BBH and the minimum of every genome pair in the given file, to add genomes later\n"
+        << "--add to reuse the pairs of the given state file, computing only those with the added genomes (state updated in the same file if --state is not given)\n"
+        << "--pair-cache to indicate the directory where the runs share the BBH of the genome pairs already computed\n"
+        << "--shard i/N to compute only the part i (from 0 to N - 1) of the pairs of different genomes, minimums in output.min\n"
+        << "--shard-dir to compute the batches of pairs of different genomes claimed with lock files in the given shared directory, minimums in output.min\n"
+        << "--merge to indicate the output of a shard to merge (repeated for every shard): the minimums are reduced and every genome is compared with itself\n";
 #endif
 }
+/**
+ * @brief Parses a memory size.
+ *
+ * @param arg The size, in MiB or followed by K, M or G.
+ * @param bytes Reference to store the size in bytes.
+ * @return False if arg is not a valid size.
+*/
+bool parseMemorySize(const char* arg, std::size_t& bytes) {
+    char* end;
+    double size = strtod(arg, &end);
+    if (end == arg || size < 0)
+        return false;
+
+    double unit = 1024.0 * 1024.0;
+    switch (*end) {
+    case 'K': case 'k':
+        unit = 1024.0;
+        ++end;
+        break;
+    case 'M': case 'm':
+        ++end;
+        break;
+    case 'G': case 'g':
+        unit = 1024.0 * 1024.0 * 1024.0;
+        ++end;
+        break;
+    }
+    if (*end != '\0')
+        return false;
+
+    bytes = static_cast<std::size_t>(size * unit);
+    return true;
+}
+
 /**
  * @brief Parse command line arguments.
  *
- * This function parses command line arguments using getopt and sets the corresponding
- * variables according to the options provided.
+ * This function parses command line arguments using getopt_long and sets the corresponding
+ * fields of the options according to the options provided.
  *
  * @param argc The number of command line arguments.
  * @param argv The array of command line arguments.
- * @param k Reference to an integer to store the dimension of kmers.
- * @param inFile Reference to a string to store the input file path.
- * @param outFile Reference to a string to store the output file path.
- * @param threadNum Reference to an unsigned short to store the number of threads.
- * @param mode Reference to a boolean to indicate a specific mode.
- * @param discard Reference to a float to indicate a discard value during similarity computation.
+ * @param options Reference to the options of the run.
 */
-void parser(int argc, char* argv[], int& k, std::string& inFile, std::string& outFile, ushort& threadNum, bool& mode, float& discard, bool& frags) {
+void parser(int argc, char* argv[], Options& options) {
+    // le opzioni lunghe senza corrispettivo corto usano valori oltre i caratteri
+    enum { memBudgetOption = 256, blockGenomesOption, spillDirOption, checkpointOption, resumeOption, stateOption, addOption, pairCacheOption, shardOption, shardDirOption, mergeOption };
+    static const struct option longOptions[] = {
+        {"mem-budget", required_argument, nullptr, memBudgetOption},
+        {"block-genomes", required_argument, nullptr, blockGenomesOption},
+        {"spill-dir", required_argument, nullptr, spillDirOption},
+        {"checkpoint", required_argument, nullptr, checkpointOption},
+        {"resume", no_argument, nullptr, resumeOption},
+        {"state", required_argument, nullptr, stateOption},
+        {"add", required_argument, nullptr, addOption},
+        {"pair-cache", required_argument, nullptr, pairCacheOption},
+        {"shard", required_argument, nullptr, shardOption},
+        {"shard-dir", required_argument, nullptr, shardDirOption},
+        {"merge", required_argument, nullptr, mergeOption},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+
     int option;
-    while ((option = getopt(argc, argv, "d:i:o:k:t:hmf")) != -1) {
+    while ((option = getopt_long(argc, argv, "d:i:o:k:t:T:K:E:P:hmf", longOptions, nullptr)) != -1) {
         switch (option) {
         case 'i':
-            inFile = optarg;
+            options.inFile = optarg;
             break;
         case 'o':
-            outFile = optarg;
+            options.outFile = optarg;
             break;
         case 'k':
-            k = atoi(optarg);
+            options.k = atoi(optarg);
             break;
         case 't':
-            threadNum = atoi(optarg);
+            options.threadNum = atoi(optarg);
             break;
         case 'd':
-            discard = atof(optarg);
-            shared::cut = discard;
-            if (discard > 1 || discard < 0) {
+            options.discard = atof(optarg);
+            shared::cut = options.discard;
+            if (options.discard > 1 || options.discard < 0) {
                 printTitle();
                 printHelp();
                 exit(1);
             }
             break;
         case 'm':
-            mode = true;
+            options.mode = true;
             break;
         case 'f':
-            frags = true;
+            options.frags = true;
+            break;
+        case 'T':
+            options.tileSize = atoi(optarg);
+            if (options.tileSize < 0) {
+                printTitle();
+                printHelp();
+                exit(1);
+            }
+            break;
+        case 'K':
+            if (!parseSimilarityKernel(optarg, options.kernel)) {
+                printTitle();
+                printHelp();
+                exit(1);
+            }
+            break;
+        case 'E':
+            if (!parseBBHEngine(optarg, options.engine)) {
+                printTitle();
+                printHelp();
+                exit(1);
+            }
+            break;
+        case 'P':
+            options.concurrentPairs = atoi(optarg);
+            if (options.concurrentPairs < 0) {
+                printTitle();
+                printHelp();
+                exit(1);
+            }
+            break;
+        case memBudgetOption:
+            if (!parseMemorySize(optarg, options.memBudget)) {
+                printTitle();
+                printHelp();
+                exit(1);
+            }
+            break;
+        case blockGenomesOption:
+            options.blockGenomes = atoi(optarg);
+            if (options.blockGenomes < 0) {
+                printTitle();
+                printHelp();
+                exit(1);
+            }
+            break;
+        case spillDirOption:
+            options.spillDir = optarg;
+            break;
+        case checkpointOption:
+            options.checkpoint = atoi(optarg);
+            if (options.checkpoint < 0) {
+                printTitle();
+                printHelp();
+                exit(1);
+            }
+            break;
+        case resumeOption:
+            options.resume = true;
+            break;
+        case stateOption:
+            options.stateFile = optarg;
+            break;
+        case addOption:
+            options.addFile = optarg;
+            break;
+        case pairCacheOption:
+            options.pairCache = optarg;
+            break;
+        case shardOption:
+            if (std::sscanf(optarg, "%d/%d", &options.shardIndex, &options.shardCount) != 2 || options.shardIndex < 0 || options.shardCount <= 0 || options.shardIndex >= options.shardCount) {
+                printTitle();
+                printHelp();
+                exit(1);
+            }
+            break;
+        case shardDirOption:
+            options.shardDir = optarg;
+            break;
+        case mergeOption:
+            options.mergeFiles.push_back(optarg);
             break;
         case 'h':
             printTitle();
@@ -126,62 +328,117 @@ void parser(int argc, char* argv[], int& k, std::string& inFile, std::string& ou
 }
 
 
+/**
+ * @brief Runs the homology engine specialized for kmers of length K.
+ *
+ * @tparam K The length of kmers known at compile time, 0 for the generic engine.
+ * @param options The options of the run.
+ * @param gh The loaded genomes.
+*/
+template<shared::kType K>
+void runHomology(const Options& options, GenomesContainer& gh) {
+    std::unique_ptr<Homology<K>> hd(
+        options.threadNum == 0 || options.threadNum > std::thread::hardware_concurrency() ?
+        new Homology<K>(options.k, options.outFile) :
+        new Homology<K>(options.k, options.outFile, options.threadNum)
+    );
+    if (options.tileSize >= 0)
+        hd->setTileSize(options.tileSize);
+    hd->setSimilarityKernel(options.kernel);
+    hd->setBBHEngine(options.engine);
+    hd->setConcurrentPairs(options.concurrentPairs);
+    hd->setProfileBudget(options.memBudget);
+    if (options.blockGenomes >= 0)
+        hd->setBlockGenomes(options.blockGenomes);
+    hd->setSpillDirectory(options.spillDir);
+    if (options.checkpoint >= 0)
+        hd->setCheckpoint(options.checkpoint, options.resume);
+    if (!options.stateFile.empty())
+        hd->setRunState(options.stateFile);
+    if (!options.addFile.empty())
+        hd->setPreviousRunState(options.addFile);
+    hd->setPairCache(options.pairCache);
+    if (options.shardCount > 0)
+        hd->setShard(options.shardIndex, options.shardCount);
+    hd->setShardDirectory(options.shardDir);
+    for (auto file = options.mergeFiles.begin(); file != options.mergeFiles.end(); ++file)
+        hd->addMergeFile(*file);
+    hd->calculateBidirectionalBestHit(gh, options.mode);
+}
+
+
 int main(int argc, char* argv[]) {
 
-    int k = 1;
-    ushort threadNum = 0;
-    std::string inFile = "";
-    std::string outFile = "";
-    bool mode = false;
-    float discard = 0.5;
-    bool frags = false;
-    parser(argc, argv, k, inFile, outFile, threadNum, mode, discard, frags);
+    Options options;
+    parser(argc, argv, options);
+
+    // riprendere un calcolo richiede i checkpoint anche per il seguito
+    if (options.resume && options.checkpoint < 0)
+        options.checkpoint = 60;
 
 #ifndef DEV_MODE
-    std::cerr << "\nDiscard value: " << discard;
-    std::cerr << "\nInput File: " << inFile;
-    std::cerr << "\nOutput File: " << outFile;
-    std::cerr << "\nMode: " << mode;
-    std::cerr << "\nThread number: " << threadNum;
-    std::cerr << "\nK: " << k;
-    std::cerr << "\nFrags: " << frags;
+    std::cerr << "\nDiscard value: " << options.discard;
+    std::cerr << "\nInput File: " << options.inFile;
+    std::cerr << "\nOutput File: " << options.outFile;
+    std::cerr << "\nMode: " << options.mode;
+    std::cerr << "\nThread number: " << options.threadNum;
+    std::cerr << "\nK: " << options.k;
+    std::cerr << "\nFrags: " << options.frags;
 
 #else
-    std::cout << "\nDiscard value: " << discard;
-    std::cout << "\nInput File: " << inFile;
-    std::cout << "\nOutput File: " << outFile;
-    std::cout << "\nMode: " << mode;
-    std::cout << "\nThread number: " << threadNum;
-    std::cout << "\nK: " << k;
-    std::cout << "\nFrags: " << frags;
+    std::cout << "\nDiscard value: " << options.discard;
+    std::cout << "\nInput File: " << options.inFile;
+    std::cout << "\nOutput File: " << options.outFile;
+    std::cout << "\nMode: " << options.mode;
+    std::cout << "\nThread number: " << options.threadNum;
+    std::cout << "\nK: " << options.k;
+    std::cout << "\nFrags: " << options.frags;
 #endif
 
-    if (inFile == "" || outFile == "" || k == 0) {
+    if (options.inFile == "" || options.outFile == "" || options.k == 0) {
+        exit(1);
+    }
+
+    // i geni frammentati non supportano cache, blocchi, checkpoint, stati, shard e unione
+    if (options.frags && (
+        options.memBudget > 0 || options.blockGenomes >= 0 || !options.spillDir.empty() ||
+        options.checkpoint >= 0 || options.resume || !options.stateFile.empty() || !options.addFile.empty() ||
+        !options.pairCache.empty() || options.shardCount > 0 || !options.shardDir.empty() || !options.mergeFiles.empty()
+    )) {
+        printTitle();
+        printHelp();
         exit(1);
     }
 
-    if (frags) {
+    // le coppie ripristinate dal checkpoint non hanno i BBH da salvare nello stato o nella cache
+    if (options.resume && (!options.stateFile.empty() || !options.addFile.empty() || !options.pairCache.empty())) {
+        printTitle();
+        printHelp();
+        exit(1);
+    }
+
+    if (options.frags) {
         FragGenomesContainer gh;
-        FragsFileLoader fl(inFile);
+        FragsFileLoader fl(options.inFile);
         fl.loadFile(gh);
         // auto& genomes = gh.getGenomes();
         // std::cerr<<"\nPrinting genomes\n";
         // for(auto g = genomes.begin(); g != genomes.end(); ++g) {
         //     g->print(std::cerr);
         // }
-        if (threadNum == 0 || threadNum > std::thread::hardware_concurrency()) {
-            FragHomology hd(k, outFile);
-            hd.calculateBidirectionalBestHit(gh, mode);
+        if (options.threadNum == 0 || options.threadNum > std::thread::hardware_concurrency()) {
+            FragHomology hd(options.k, options.outFile);
+            hd.calculateBidirectionalBestHit(gh, options.mode);
         }
         else {
-            FragHomology hd(k, outFile, threadNum);
-            hd.calculateBidirectionalBestHit(gh, mode);
+            FragHomology hd(options.k, options.outFile, options.threadNum);
+            hd.calculateBidirectionalBestHit(gh, options.mode);
         }
 
     }
     else {
         GenomesContainer gh;
-        FileLoader fl(inFile);
+        FileLoader fl(options.inFile);
         fl.loadFile(gh);
 
         // auto& genomes = gh.getGenomes();
@@ -190,13 +447,39 @@ int main(int argc, char* argv[]) {
         //     g->print(std::cerr);
         // }
 
-        if (threadNum == 0 || threadNum > std::thread::hardware_concurrency()) {
-            Homology hd(k, outFile);
-            hd.calculateBidirectionalBestHit(gh, mode);
+        // errori dell'utente (file mancanti, stati o checkpoint non validi...): messaggio e uscita
+        try {
+            // k comuni con un motore specializzato, gli altri con quello generico
+            switch (options.k) {
+            case 2:
+                runHomology<2>(options, gh);
+                break;
+            case 3:
+                runHomology<3>(options, gh);
+                break;
+            case 4:
+                runHomology<4>(options, gh);
+                break;
+            case 5:
+                runHomology<5>(options, gh);
+                break;
+            case 6:
+                runHomology<6>(options, gh);
+                break;
+            case 7:
+                runHomology<7>(options, gh);
+                break;
+            case 8:
+                runHomology<8>(options, gh);
+                break;
+            default:
+                runHomology<0>(options, gh);
+                break;
+            }
         }
-        else {
-            Homology hd(k, outFile, threadNum);
-            hd.calculateBidirectionalBestHit(gh, mode);
+        catch (const std::exception& e) {
+            std::cerr << "\nError: " << e.what() << "\n";
+            exit(1);
         }
     }
 
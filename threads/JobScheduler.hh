@@ -0,0 +1,180 @@
+#ifndef JOB_SCHEDULER_INCLUDE_GUARD
+#define JOB_SCHEDULER_INCLUDE_GUARD 1
+
+
+#include <cstddef>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <exception>
+#include <condition_variable>
+
+
+/**
+ * @file JobScheduler.hh
+ * @brief Definitions for the JobScheduler class.
+ */
+
+/**
+ * @namespace threads
+ * @brief Namespace containing definitions for threads related classes.
+ */
+
+namespace threads {
+
+    /**
+     * @class JobScheduler
+     * @brief Runs coarse jobs on a few driver threads, the most expensive first.
+     *
+     * Every job is a whole unit of work (for example a genome pair) that submits its own tasks to a
+     * ThreadPool and waits for them: while a job waits at one of its barriers the tasks of the other
+     * jobs keep the pool busy. The jobs start in decreasing order of cost (longest processing time
+     * first) so that the last ones to finish are short, jobs with the same cost start in the order
+     * they were added. A running job may add new jobs. If a job throws, the jobs not started yet are
+     * dropped and run rethrows the exception once the running ones are completed.
+     */
+    class JobScheduler {
+        public:
+            using cost_t = std::size_t;
+            using job_t = std::function<void()>;
+        private:
+            using thread_ct = std::vector<std::thread>;
+
+            struct Job {
+                cost_t cost;
+                std::size_t order;
+                job_t run;
+            };
+
+            struct JobOrder {
+                bool operator()(const Job& a, const Job& b) const {
+                    // in cima il costo maggiore, a parita' il primo aggiunto
+                    return a.cost != b.cost ? a.cost < b.cost : a.order > b.order;
+                }
+            };
+
+            using queue_t = std::priority_queue<Job, std::vector<Job>, JobOrder>;
+
+            queue_t jobs_;
+            std::size_t added_;
+            std::size_t running_;
+            // prima eccezione lanciata da un job, rilanciata da run
+            std::exception_ptr error_;
+            std::mutex mutex_;
+            std::condition_variable changed_;
+
+            /**
+             * @brief The loop of a driver: takes the next job until there are neither queued nor running jobs.
+             */
+            inline void drive();
+        public:
+            /**
+             * @brief Constructs a scheduler without jobs.
+             */
+            inline JobScheduler();
+
+            JobScheduler(const JobScheduler&) = delete;
+            JobScheduler(JobScheduler&&) = delete;
+            JobScheduler& operator=(const JobScheduler&) = delete;
+            JobScheduler& operator=(JobScheduler&&) = delete;
+
+            /**
+             * @brief Default destructor.
+             */
+            ~JobScheduler() = default;
+
+            /**
+             * @brief Adds a job, thread safe (also from a running job).
+             * @param cost The estimated cost, used only to order the jobs.
+             * @param job The job.
+             */
+            inline void add(const cost_t cost, const job_t& job);
+
+            /**
+             * @brief Runs the jobs and blocks until all of them, including those added meanwhile, are completed.
+             *        Rethrows the first exception thrown by a job.
+             * @param drivers Number of jobs run at the same time, the calling thread is one of the drivers.
+             */
+            inline void run(const std::size_t drivers);
+    };
+
+    inline
+    JobScheduler::JobScheduler()
+    : added_(0), running_(0) {}
+
+    inline void
+    JobScheduler::add(const cost_t cost, const job_t& job) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        Job entry;
+        entry.cost = cost;
+        entry.order = added_++;
+        entry.run = job;
+        jobs_.push(entry);
+        changed_.notify_one();
+    }
+
+    inline void
+    JobScheduler::drive() {
+        while(true) {
+            job_t job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                // un job in esecuzione puo' ancora aggiungerne altri
+                changed_.wait(
+                    lock, [this] {
+                        return !jobs_.empty() || running_ == 0;
+                    }
+                );
+                if(jobs_.empty())
+                    break;
+
+                job = jobs_.top().run;
+                jobs_.pop();
+                ++running_;
+            }
+
+            std::exception_ptr error;
+            try {
+                job();
+            } catch(...) {
+                error = std::current_exception();
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if(error) {
+                    if(!error_)
+                        error_ = error;
+                    jobs_ = queue_t();
+                }
+                --running_;
+                if(running_ == 0 && jobs_.empty())
+                    changed_.notify_all();
+            }
+        }
+    }
+
+    inline void
+    JobScheduler::run(const std::size_t drivers) {
+        thread_ct threads;
+        for(std::size_t i = 1; i < drivers; ++i)
+            threads.emplace_back(&JobScheduler::drive, this);
+
+        drive();
+
+        for(auto thread = threads.begin(); thread != threads.end(); ++thread)
+            thread->join();
+
+        if(error_) {
+            std::exception_ptr error = error_;
+            error_ = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+}
+
+
+#endif
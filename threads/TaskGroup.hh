@@ -0,0 +1,128 @@
+#ifndef TASK_GROUP_INCLUDE_GUARD
+#define TASK_GROUP_INCLUDE_GUARD 1
+
+
+#include <cstddef>
+#include <mutex>
+#include <condition_variable>
+
+#include "ThreadPool.hh"
+
+
+/**
+ * @file TaskGroup.hh
+ * @brief Definitions for the TaskGroup class.
+ */
+
+/**
+ * @namespace threads
+ * @brief Namespace containing definitions for threads related classes.
+ */
+
+namespace threads {
+
+    /**
+     * @class TaskGroup
+     * @brief The tasks submitted to a ThreadPool by one caller, waited for without waiting for the others.
+     *
+     * ThreadPool::tasksCompleted counts every task in the pool: when several callers share the
+     * pool (for example genome pairs computed at the same time) each of them waits only for its
+     * own tasks through a TaskGroup. wait must not be called from a task of the same pool.
+     */
+    class TaskGroup {
+        private:
+            using pool_t = ThreadPool;
+            using pool_tr = pool_t&;
+            using task_t = pool_t::task_t;
+
+            pool_tr pool_;
+            std::size_t pending_;
+            std::mutex mutex_;
+            std::condition_variable done_;
+
+            /**
+             * @brief Marks a task of the group as completed.
+             */
+            inline void finish();
+        public:
+            /**
+             * @brief Constructs an empty group.
+             * @param pool The pool executing the tasks.
+             */
+            inline explicit TaskGroup(pool_tr pool);
+
+            TaskGroup(const TaskGroup&) = delete;
+            TaskGroup(TaskGroup&&) = delete;
+            TaskGroup& operator=(const TaskGroup&) = delete;
+            TaskGroup& operator=(TaskGroup&&) = delete;
+
+            /**
+             * @brief Waits for the tasks still running, then destroys the group.
+             */
+            inline ~TaskGroup();
+
+            /**
+             * @brief Gets the total number of threads of the pool.
+             * @return The total number of threads of the pool.
+             */
+            inline std::size_t getTotalThread() const {
+                return pool_.getTotalThread();
+            }
+
+            /**
+             * @brief Executes a task in the pool as part of the group.
+             * @param task The task to execute.
+             */
+            inline void execute(const task_t& task);
+
+            /**
+             * @brief Blocks until every task of the group is completed.
+             */
+            inline void wait();
+    };
+
+    inline
+    TaskGroup::TaskGroup(pool_tr pool)
+    : pool_(pool), pending_(0) {}
+
+    inline
+    TaskGroup::~TaskGroup() {
+        wait();
+    }
+
+    inline void
+    TaskGroup::finish() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // la notifica avviene sotto lock: chi attende non distrugge il gruppo prima che finisca
+        if(--pending_ == 0)
+            done_.notify_all();
+    }
+
+    inline void
+    TaskGroup::execute(const task_t& task) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ++pending_;
+        }
+        pool_.execute(
+            [this, task] {
+                task();
+                finish();
+            }
+        );
+    }
+
+    inline void
+    TaskGroup::wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(
+            lock, [this] {
+                return pending_ == 0;
+            }
+        );
+    }
+
+}
+
+
+#endif
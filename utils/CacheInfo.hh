@@ -0,0 +1,32 @@
+#include <cstddef>
+#include <unistd.h>
+
+
+#ifndef CACHE_INFO_INCLUDE_GUARD
+#define CACHE_INFO_INCLUDE_GUARD
+
+namespace utilities {
+
+    class CacheInfo {
+        private:
+            // valore usato se il sistema non riporta la dimensione della cache
+            static const std::size_t defaultL2Size_ = 256 * 1024;
+        public:
+            CacheInfo() = delete;
+
+            // dimensione in byte della cache L2 di un core
+            static std::size_t getL2Size();
+    };
+
+    inline std::size_t CacheInfo::getL2Size() {
+        long size = -1;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+        size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+        if(size <= 0)
+            return defaultL2Size_;
+        return static_cast<std::size_t>(size);
+    }
+
+}
+#endif
@@ -37,6 +37,8 @@ namespace utilities {
             std::fstream openAppend();
             void close(std::fstream& stream);
             void write(std::string line, std::fstream& file);
+            void writeLines(const std::string& lines, std::fstream& file);
+            const std::string& getFileName() const;
             ~FileWriter();
     };
 
@@ -85,6 +87,17 @@ namespace utilities {
         }
     }
 
+    void FileWriter::writeLines(const std::string& lines, std::fstream& file) {
+        {
+            std::unique_lock<mutex_t> lock(mutex_);
+            file<<lines;
+        }
+    }
+
+    const std::string& FileWriter::getFileName() const {
+        return fileName_;
+    }
+
     FileWriter::~FileWriter() {
     }
 
@@ -0,0 +1,45 @@
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+
+#ifndef MEMORY_INFO_INCLUDE_GUARD
+#define MEMORY_INFO_INCLUDE_GUARD
+
+namespace utilities {
+
+    class MemoryInfo {
+        private:
+            // valore usato se il sistema non riporta la memoria disponibile
+            static const std::size_t defaultAvailable_ = 1024 * 1024 * 1024;
+        public:
+            MemoryInfo() = delete;
+
+            // memoria in byte che puo' essere allocata senza ricorrere allo swap
+            static std::size_t getAvailableMemory();
+    };
+
+    inline std::size_t MemoryInfo::getAvailableMemory() {
+        // MemAvailable conta anche la page cache che il sistema puo' liberare
+        std::ifstream meminfo("/proc/meminfo");
+        std::string key;
+        std::size_t kb;
+        while(meminfo >> key >> kb) {
+            if(key == "MemAvailable:")
+                return kb * 1024;
+            meminfo.ignore(256, '\n');
+        }
+
+        long pages = -1, pageSize = -1;
+#ifdef _SC_AVPHYS_PAGES
+        pages = sysconf(_SC_AVPHYS_PAGES);
+        pageSize = sysconf(_SC_PAGESIZE);
+#endif
+        if(pages <= 0 || pageSize <= 0)
+            return defaultAvailable_;
+        return static_cast<std::size_t>(pages) * static_cast<std::size_t>(pageSize);
+    }
+
+}
+#endif